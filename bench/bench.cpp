@@ -0,0 +1,403 @@
+#include "Search.h"
+#include "Batch.h"
+#include "StateSet.h"
+#include "Options.h"
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <chrono>
+#include <climits>
+#include <sys/resource.h>
+
+using namespace std;
+
+/* benchmark suite. sweeps levels x configurations and microbenchmarks the
+ * hot State operations, writes the results as JSON
+ *   sbp_bench [--levels <directory|glob>] [--config name,name,..] [--repeat N]
+ *             [--search-threads N] [--min-time s] [--no-search] [--no-micro] [--generic] [--out file]
+ * --levels defaults to "level", --config to bfs, dfs, iddfs and astar with both heuristics.
+ * the board scans (isSolved, equal, equivalent, blocking) run once per
+ * instruction set of the CPU, named e.g. "isSolved/avx2" (see Kernels.h)
+ * searches report the fastest of --repeat runs (default 1), micro benchmarks
+ * repeat until they ran for --min-time seconds (default 0.2).
+ * --generic runs the searches without the code for fixed board sizes (Board.h) */
+
+typedef chrono::steady_clock Clock;
+
+
+static long long nanoseconds(const Clock::time_point& start, const Clock::time_point& end) {
+	return chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+}
+
+
+/* resets the peak resident set size of the process, so that the next
+ * peakRSS() call only covers what ran in between. Linux only (clear_refs 5),
+ * elsewhere the peak of the whole process is reported */
+static void resetPeakRSS() {
+	ofstream f("/proc/self/clear_refs");
+	if (f) f << "5";
+}
+
+
+// peak resident set size in kB
+static long peakRSS() {
+	ifstream f("/proc/self/status");
+	string line;
+	while (getline(f, line)) {
+		if (line.compare(0, 6, "VmHWM:") == 0) {
+			return stol(line.substr(6));
+		}
+	}
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+
+// quotes a string for JSON (level paths and names only, no control characters)
+static string quote(const string& s) {
+	string q = "\"";
+	for (char c : s) {
+		if (c == '"' || c == '\\') q += '\\';
+		q += c;
+	}
+	return q + "\"";
+}
+
+
+struct SearchRun {
+	string level;
+	string config;
+	Search::Result result;
+	long long ns;
+	long rss;
+};
+
+
+struct MicroRun {
+	string name;
+	string level;
+	long long ops;
+	long long ns;
+};
+
+
+// solves every level with every configuration, one after the other
+static vector<SearchRun> benchSearches(const vector<string>& levels, const vector<Batch::Config>& configs,
+	const int repeat, const unsigned int threads, const bool fixedSizes) {
+	const Search search(nullptr, fixedSizes);
+	vector<SearchRun> runs;
+	for (const string& level : levels) {
+		Matrix m(level);
+		for (const Batch::Config& c : configs) {
+			SearchRun run{ level, c.name, Search::Result(), -1, 0 };
+			for (int r = 0; r < repeat; r++) {
+				resetPeakRSS();
+				auto start = Clock::now();
+				Search::Result result = search.run(m, c.algorithm, c.heuristic, threads);
+				long long ns = nanoseconds(start, Clock::now());
+				long rss = peakRSS();
+				if (run.ns < 0 || ns < run.ns) {
+					run.result = result;
+					run.ns = ns;
+				}
+				if (rss > run.rss) run.rss = rss;
+			}
+			cerr << level << " " << c.name << " " << run.ns / 1000000.0 << "ms" << endl;
+			runs.push_back(run);
+		}
+	}
+	return runs;
+}
+
+
+/* states to run the micro benchmarks on: a reproducible random walk
+ * (normalized, like the search algorithms see them) from the start state */
+static vector<State> sampleStates(const State& start, const size_t n) {
+	mt19937 eng(42);
+	vector<State> states;
+	vector<Move> moves;
+	State s(start);
+	s.normalize();
+	while (states.size() < n) {
+		states.push_back(s);
+		s.getAllMoves(moves);
+		if (moves.empty() || s.isSolved()) {
+			s = start;
+			s.normalize();
+			continue;
+		}
+		uniform_int_distribution<size_t> distr(0, moves.size() - 1);
+		s.applyMove(moves[distr(eng)]);
+		s.normalize();
+	}
+	return states;
+}
+
+
+/* calls "op" (which does one pass over the samples and returns the
+ * # of operations it did) until "minTime" seconds have passed */
+template <typename Op>
+static MicroRun measure(const string& name, const string& level, const double minTime, Op op) {
+	MicroRun run{ name, level, 0, 0 };
+	long long limit = (long long) (minTime * 1e9);
+	auto start = Clock::now();
+	do {
+		run.ops += op();
+		run.ns = nanoseconds(start, Clock::now());
+	} while (run.ns < limit);
+	return run;
+}
+
+
+// keeps the compiler from optimizing benchmarked results away
+static volatile size_t sink;
+
+
+static vector<MicroRun> benchMicro(const vector<string>& levels, const double minTime) {
+	vector<MicroRun> runs;
+	for (const string& level : levels) {
+		vector<State> states = sampleStates(State(Matrix(level)), 1024);
+		// the moves and children of every sample
+		vector<pair<const State*, Move>> moves;
+		vector<State> children;
+		vector<size_t> childHashes;
+		vector<Move> list;
+		for (const State& s : states) {
+			s.getAllMoves(list);
+			for (const Move& move : list) {
+				moves.push_back(make_pair(&s, move));
+				children.push_back(s.applyMoveCloning(move));
+				childHashes.push_back(s.moveHash(s.hash(), move));
+			}
+		}
+		// visited set holding the samples. the children are hits and misses
+		StateSet visited;
+		for (const State& s : states) {
+			visited.insert(&s);
+		}
+
+		runs.push_back(measure("getAllMoves", level, minTime, [&]() {
+			size_t n = 0;
+			for (const State& s : states) {
+				s.getAllMoves(list);
+				n += list.size();
+			}
+			sink = n;
+			return (long long) states.size();
+		}));
+		runs.push_back(measure("applyMoveCloning", level, minTime, [&]() {
+			size_t n = 0;
+			for (const pair<const State*, Move>& m : moves) {
+				n += m.first->applyMoveCloning(m.second).at(m.second.piece.row, m.second.piece.col);
+			}
+			sink = n;
+			return (long long) moves.size();
+		}));
+		runs.push_back(measure("normalize", level, minTime, [&]() {
+			size_t n = 0;
+			for (const State& c : children) {
+				State s(c);
+				s.normalize();
+				n += s.at(1, 1);
+			}
+			sink = n;
+			return (long long) children.size();
+		}));
+		runs.push_back(measure("hash", level, minTime, [&]() {
+			size_t n = 0;
+			for (const State& s : states) {
+				n ^= s.hash();
+			}
+			sink = n;
+			return (long long) states.size();
+		}));
+		runs.push_back(measure("visitedLookup", level, minTime, [&]() {
+			size_t n = 0;
+			for (size_t i = 0; i < children.size(); i++) {
+				n += visited.contains(children[i], childHashes[i]);
+			}
+			sink = n;
+			return (long long) children.size();
+		}));
+
+		// the board scans (Kernels.h) with every instruction set the CPU supports
+		vector<State> copies(states), normalized(children);
+		for (State& c : normalized) {
+			c.normalize();
+		}
+		for (int l = 0; l < Kernels::LEVELS; l++) {
+			Kernels::Level kernels = (Kernels::Level) l;
+			if (!Kernels::supported(kernels)) continue;
+			Kernels::select(kernels);
+			string suffix = string("/") + Kernels::name(kernels);
+			runs.push_back(measure("isSolved" + suffix, level, minTime, [&]() {
+				size_t n = 0;
+				for (const State& s : states) {
+					n += s.isSolved();
+				}
+				sink = n;
+				return (long long) states.size();
+			}));
+			runs.push_back(measure("equal" + suffix, level, minTime, [&]() {
+				size_t n = 0;
+				for (size_t i = 0; i < states.size(); i++) {
+					n += states[i] == copies[i];
+				}
+				sink = n;
+				return (long long) states.size();
+			}));
+			runs.push_back(measure("equivalent" + suffix, level, minTime, [&]() {
+				size_t n = 0;
+				for (size_t i = 0; i < children.size(); i++) {
+					n += children[i].equivalent(normalized[i]);
+				}
+				sink = n;
+				return (long long) children.size();
+			}));
+			runs.push_back(measure("blocking" + suffix, level, minTime, [&]() {
+				size_t n = 0;
+				const Search::Heuristic::Context context;
+				for (const State& s : states) {
+					n += Search::Heuristic::blocking(s, context);
+				}
+				sink = n;
+				return (long long) states.size();
+			}));
+		}
+		Kernels::select(Kernels::best());
+	}
+	return runs;
+}
+
+
+static void writeJSON(ostream& os, const vector<SearchRun>& searches, const vector<MicroRun>& micro) {
+	os << "{" << endl;
+	os << "  \"searches\": [";
+	for (size_t i = 0; i < searches.size(); i++) {
+		const SearchRun& r = searches[i];
+		double seconds = r.ns / 1e9;
+		os << (i ? "," : "") << endl << "    {"
+			<< "\"level\": " << quote(r.level)
+			<< ", \"config\": " << quote(r.config)
+			<< ", \"solved\": " << (r.result.solved() ? "true" : "false")
+			<< ", \"length\": " << r.result.length()
+			<< ", \"nodes\": " << r.result.nodecount
+			<< ", \"time_ns\": " << r.ns
+			<< ", \"nodes_per_sec\": " << (long long) (seconds > 0 ? r.result.nodecount / seconds : 0)
+			<< ", \"peak_rss_kb\": " << r.rss;
+		if (Stats::enabled) {
+			os << ", \"stats\": ";
+			r.result.stats.writeJSON(os);
+		}
+		os << "}";
+	}
+	os << endl << "  ]," << endl;
+	os << "  \"micro\": [";
+	for (size_t i = 0; i < micro.size(); i++) {
+		const MicroRun& r = micro[i];
+		os << (i ? "," : "") << endl << "    {"
+			<< "\"name\": " << quote(r.name)
+			<< ", \"level\": " << quote(r.level)
+			<< ", \"ops\": " << r.ops
+			<< ", \"time_ns\": " << r.ns
+			<< ", \"ns_per_op\": " << (double) r.ns / r.ops << "}";
+	}
+	os << endl << "  ]," << endl;
+	os << "  \"peak_rss_kb\": " << peakRSS() << endl;
+	os << "}" << endl;
+}
+
+
+int main(int argc, char* argv[]) {
+	string levelPath = "level", outPath;
+	int repeat = 1;
+	unsigned int threads = 1;
+	double minTime = 0.2;
+	bool searches = true, micro = true, fixedSizes = true;
+	vector<Batch::Config> configs;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--no-search") {
+			searches = false;
+			continue;
+		}
+		if (arg == "--no-micro") {
+			micro = false;
+			continue;
+		}
+		if (arg == "--generic") {
+			fixedSizes = false;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			cerr << "Missing value for '" << arg << "'" << endl;
+			return 1;
+		}
+		string value = argv[++i];
+		if (arg == "--levels") {
+			levelPath = value;
+		}
+		else if (arg == "--repeat") {
+			unsigned long long n;
+			if (!Options::parseCount(value, INT_MAX, n)) return Options::invalidValue(arg, value);
+			repeat = (int) n;
+		}
+		else if (arg == "--search-threads") {
+			unsigned long long n;
+			if (!Options::parseCount(value, UINT_MAX, n)) return Options::invalidValue(arg, value);
+			threads = (unsigned int) n;
+		}
+		else if (arg == "--min-time") {
+			if (!Options::parseSeconds(value, minTime)) return Options::invalidValue(arg, value);
+		}
+		else if (arg == "--out") {
+			outPath = value;
+		}
+		else if (arg == "--config") {
+			stringstream ss(value);
+			string name;
+			while (getline(ss, name, ',')) {
+				Batch::Config c;
+				if (!Batch::findConfig(name, c)) {
+					cerr << "Unknown configuration '" << name << "'" << endl;
+					return 1;
+				}
+				configs.push_back(c);
+			}
+		}
+		else {
+			cerr << "Unknown argument '" << arg << "'" << endl;
+			return 1;
+		}
+	}
+	if (configs.empty()) {
+		for (const char* name : { "bfs", "dfs", "iddfs", "astar-manhatten", "astar-blocking" }) {
+			Batch::Config c;
+			Batch::findConfig(name, c);
+			configs.push_back(c);
+		}
+	}
+	vector<string> levels = Batch::findLevels(levelPath);
+	if (levels.empty()) {
+		cerr << "No level files found for '" << levelPath << "'" << endl;
+		return 1;
+	}
+
+	vector<MicroRun> microRuns;
+	if (micro) {
+		microRuns = benchMicro(levels, minTime);
+	}
+	vector<SearchRun> searchRuns;
+	if (searches) {
+		searchRuns = benchSearches(levels, configs, repeat, threads, fixedSizes);
+	}
+	if (outPath.empty()) {
+		writeJSON(cout, searchRuns, microRuns);
+	}
+	else {
+		ofstream out(outPath);
+		writeJSON(out, searchRuns, microRuns);
+	}
+	return 0;
+}
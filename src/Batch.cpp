@@ -0,0 +1,136 @@
+#include "Batch.h"
+#include <algorithm>
+#include <glob.h>
+#include <sys/stat.h>
+
+
+Batch::Batch(const unsigned int threads, const unsigned int searchThreads, SolutionCache* cache,
+	const Budget& budget, PatternDatabase::Store* patterns)
+	: pool(threads), searchThreads(searchThreads), budget(budget), search(cache, true, patterns) {
+}
+
+
+std::vector<Batch::Config> Batch::allConfigs() {
+	std::vector<Config> configs;
+	configs.push_back(Config{ "bfs", Search::BFS, Search::Heuristic::manhatten });
+	configs.push_back(Config{ "pbfs", Search::PBFS, Search::Heuristic::manhatten });
+	configs.push_back(Config{ "dfs", Search::DFS, Search::Heuristic::manhatten });
+	configs.push_back(Config{ "iddfs", Search::IDDFS, Search::Heuristic::manhatten });
+	configs.push_back(Config{ "astar-manhatten", Search::ASTAR, Search::Heuristic::manhatten });
+	configs.push_back(Config{ "astar-blocking", Search::ASTAR, Search::Heuristic::blocking });
+	configs.push_back(Config{ "astar-pattern", Search::ASTAR, Search::Heuristic::pattern });
+	configs.push_back(Config{ "astar-buckets-manhatten", Search::ASTAR_BUCKETS, Search::Heuristic::manhatten });
+	configs.push_back(Config{ "astar-buckets-blocking", Search::ASTAR_BUCKETS, Search::Heuristic::blocking });
+	configs.push_back(Config{ "astar-buckets-pattern", Search::ASTAR_BUCKETS, Search::Heuristic::pattern });
+	configs.push_back(Config{ "idastar-manhatten", Search::IDASTAR, Search::Heuristic::manhatten });
+	configs.push_back(Config{ "idastar-blocking", Search::IDASTAR, Search::Heuristic::blocking });
+	configs.push_back(Config{ "idastar-pattern", Search::IDASTAR, Search::Heuristic::pattern });
+	configs.push_back(Config{ "hdastar-manhatten", Search::HDASTAR, Search::Heuristic::manhatten });
+	configs.push_back(Config{ "hdastar-blocking", Search::HDASTAR, Search::Heuristic::blocking });
+	configs.push_back(Config{ "hdastar-pattern", Search::HDASTAR, Search::Heuristic::pattern });
+	configs.push_back(Config{ "arastar-manhatten", Search::ARASTAR, Search::Heuristic::manhatten });
+	configs.push_back(Config{ "arastar-blocking", Search::ARASTAR, Search::Heuristic::blocking });
+	configs.push_back(Config{ "arastar-pattern", Search::ARASTAR, Search::Heuristic::pattern });
+	return configs;
+}
+
+
+bool Batch::findConfig(const std::string& name, Config& config) {
+	for (const Config& c : allConfigs()) {
+		if (c.name == name) {
+			config = c;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+std::vector<std::string> Batch::findLevels(const std::string& path) {
+	std::string pattern = path;
+	struct stat info;
+	if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+		pattern = path + "/*.txt";
+	}
+	std::vector<std::string> levels;
+	glob_t g;
+	if (glob(pattern.c_str(), 0, nullptr, &g) == 0) {
+		for (std::size_t i = 0; i < g.gl_pathc; i++) {
+			levels.push_back(g.gl_pathv[i]);
+		}
+	}
+	globfree(&g);
+	std::sort(levels.begin(), levels.end());
+	return levels;
+}
+
+
+std::vector<Batch::Job> Batch::run(const std::vector<std::string>& levels, const std::vector<Config>& configs) {
+	// load every level once. the jobs only read them, broken files fail their jobs
+	std::vector<State> boards(levels.size());
+	std::vector<Job> jobs;
+	for (std::size_t l = 0; l < levels.size(); l++) {
+		Corpus::Error error = Corpus::readLevel(levels[l], boards[l]);
+		for (const Config& c : configs) {
+			jobs.push_back(Job{ levels[l], c, Search::Result(), error });
+		}
+	}
+	// every task writes to its own slot. no locking needed
+	for (std::size_t i = 0; i < jobs.size(); i++) {
+		if (jobs[i].error != Corpus::OK) continue;
+		const State* board = &boards[i / configs.size()];
+		Job* job = &jobs[i];
+		const Search* s = &search;
+		unsigned int threads = searchThreads;
+		const Budget* b = &budget;
+		pool.submit([board, job, s, threads, b]() {
+			job->result = s->run(*board, job->config.algorithm, job->config.heuristic, threads, *b);
+		});
+	}
+	pool.wait();
+	return jobs;
+}
+
+
+std::vector<Batch::Job> Batch::run(const std::string& path, const Corpus& corpus,
+	const std::vector<Config>& configs) {
+	// all jobs first: the tasks keep pointers to them
+	std::vector<Job> jobs;
+	jobs.reserve(corpus.size() * configs.size());
+	for (std::size_t b = 0; b < corpus.size(); b++) {
+		for (const Config& c : configs) {
+			jobs.push_back(Job{ path + "#" + std::to_string(b), c, Search::Result(), Corpus::OK });
+		}
+	}
+	/* one task per board and configuration, each with its own iterator.
+	 * the worker dereferences it, i.e. reads the board from the mapping */
+	Job* job = jobs.data();
+	for (Corpus::iterator it = corpus.begin(); it != corpus.end(); ++it) {
+		for (std::size_t c = 0; c < configs.size(); c++, job++) {
+			const Search* s = &search;
+			unsigned int threads = searchThreads;
+			const Budget* b = &budget;
+			pool.submit([it, job, s, threads, b]() {
+				Corpus::Entry entry = *it;
+				job->error = entry.error;
+				if (entry.error != Corpus::OK) return;
+				job->result = s->run(entry.state, job->config.algorithm, job->config.heuristic, threads, *b);
+			});
+		}
+	}
+	pool.wait();
+	return jobs;
+}
+
+
+void Batch::write(std::ostream& os, const std::vector<Job>& jobs) {
+	os << "level,config,nodes,time,length,status" << std::endl;
+	for (const Job& job : jobs) {
+		os << job.level << "," << job.config.name << ","
+			<< job.result.nodecount << "," << job.result.time << ","
+			<< job.result.length() << ","
+			<< (job.error != Corpus::OK ? Corpus::message(job.error)
+				: job.result.exceeded != Budget::NONE ? std::string(Budget::name(job.result.exceeded)) + " exceeded"
+				: "done") << std::endl;
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "Search.h"
+#include "Corpus.h"
+#include "ThreadPool.h"
+#include <string>
+#include <vector>
+#include <ostream>
+
+/* Runs (level, algorithm, heuristic) jobs in parallel on a ThreadPool.
+ * Every level is loaded once and solved with every configuration.
+ * Each job is a task of its own, the pool balances them across all cores */
+class Batch {
+
+public:
+	// a search configuration. "name" identifies it on the command line and in the output
+	struct Config {
+		std::string name;
+		Search::Algorithm algorithm;
+		Search::Heuristic::Function heuristic;
+	};
+	/* one job (level x configuration) and its result. "error" tells why
+	 * the board could not be read (the job did not run then) */
+	struct Job {
+		std::string level;
+		Config config;
+		Search::Result result;
+		Corpus::Error error;
+	};
+
+
+	/* starts the pool. 0 = one thread per hardware thread.
+	 * "searchThreads" is passed to multi-threaded algorithms (HDASTAR). The jobs
+	 * already keep all cores busy, so each search gets one thread by default.
+	 * "cache" (optional) is shared by all jobs (see SolutionCache.h).
+	 * "budget" limits every job on its own (see Budget.h).
+	 * "patterns" (optional) is shared by all jobs (see PatternDatabase::Store) */
+	Batch(const unsigned int threads = 0, const unsigned int searchThreads = 1, SolutionCache* cache = nullptr,
+		const Budget& budget = Budget(), PatternDatabase::Store* patterns = nullptr);
+	// empty destructor
+	~Batch() {};
+
+
+	// all configurations: bfs, dfs, iddfs and astar with every heuristic (no random walk)
+	static std::vector<Config> allConfigs();
+	// looks up a configuration by name (e.g. "astar-blocking"). false if unknown
+	static bool findConfig(const std::string&, Config&);
+	/* level files in a directory (*.txt) or matching a glob pattern
+	 * (e.g. "level/level1*.txt"), sorted by name */
+	static std::vector<std::string> findLevels(const std::string&);
+	/* solves every level with every configuration. results are ordered level by level.
+	 * levels that cannot be read fail their jobs (Job::error), the others still run */
+	std::vector<Job> run(const std::vector<std::string>& levels, const std::vector<Config>& configs);
+	/* solves every board of a corpus with every configuration, walking it with
+	 * Corpus::iterator. the workers read the boards straight from the mapping
+	 * (they dereference the iterator). jobs are named "path#index",
+	 * boards that are not valid fail their jobs (Job::error) */
+	std::vector<Job> run(const std::string& path, const Corpus&, const std::vector<Config>& configs);
+	/* writes the results as CSV. one line per job, length is -1 if unsolved,
+	 * status tells if the job ran, which budget limit stopped it
+	 * (e.g. "time exceeded") or why its board could not be read */
+	static void write(std::ostream&, const std::vector<Job>&);
+
+
+private:
+	ThreadPool pool;
+	const unsigned int searchThreads;
+	const Budget budget;
+	// reentrant, shared by all jobs
+	const Search search;
+};
@@ -0,0 +1,194 @@
+#pragma once
+#include "State.h"
+#include <vector>
+#include <cstring>
+
+/* Board operations of the sequential search algorithms, as a policy.
+ * The algorithms are templates on it (see Search::sequential):
+ *   AnyBoard         works on States of any size (the State member functions)
+ *   FixedBoard<W, H> only on boards of W x H cells (walls included). The
+ *                    dimensions are compile-time constants, so cell indices
+ *                    need no runtime multiply and the loops over the board
+ *                    have a fixed trip count.
+ * Both use the 64 byte State as storage (one cache line) and give the same
+ * moves in the same order, the same hashes and the same normalized States */
+struct AnyBoard {
+	static bool fits(const State&) {
+		return true;
+	}
+	static void getAllMoves(const State& s, std::vector<Move>& moves) {
+		s.getAllMoves(moves);
+	}
+	static unsigned long long applyMove(State& s, const Move& move) {
+		return s.applyMove(move);
+	}
+	static void undoMove(State& s, const Move& move, const unsigned long long exits) {
+		s.undoMove(move, exits);
+	}
+	static State applyMoveCloning(const State& s, const Move& move) {
+		return s.applyMoveCloning(move);
+	}
+	static void normalize(State& s) {
+		s.normalize();
+	}
+	static std::size_t hash(const State& s) {
+		return s.hash();
+	}
+	static std::size_t moveHash(const State& s, const std::size_t hash, const Move& move) {
+		return s.moveHash(hash, move);
+	}
+};
+
+
+template <int W, int H>
+struct FixedBoard {
+	static_assert(W >= 3 && H >= 3 && W * H <= State::MAX_CELLS, "board does not fit into a State");
+
+	// index offset of the neighbour cell in a direction
+	static constexpr int offset(const Moves dir) {
+		return dir == Moves::UP ? -W : dir == Moves::DOWN ? W : dir == Moves::LEFT ? -1 : 1;
+	}
+	// bit mask (see Kernels) of a row pattern repeated in rows [top, bottom)
+	static constexpr std::uint64_t rows(const int top, const int bottom, const std::uint64_t row) {
+		return top >= bottom ? 0 : row << (top * W) | rows(top + 1, bottom, row);
+	}
+
+	static bool fits(const State& s) {
+		return s.width == W && s.height == H;
+	}
+
+	// State::getPieces, visiting only the cells of pieces
+	static int getPieces(const State& s, Piece* pieces) {
+		signed char slot[128];
+		std::memset(slot, -1, sizeof(slot));
+		int n = 0;
+		for (std::uint64_t rest = s.maskAbove(1); rest; rest &= rest - 1) {
+			const int k = Kernels::lowest(rest);
+			const int i = k / W, j = k % W;
+			const int v = s.cells[k];
+			if (slot[v] < 0) {
+				slot[v] = (signed char) n;
+				pieces[n] = Piece{ (signed char) v, (unsigned char) i, (unsigned char) j, 1, 1 };
+				n++;
+			}
+			else {
+				Piece& p = pieces[slot[v]];
+				if (j - p.col + 1 > p.width) p.width = (unsigned char) (j - p.col + 1);
+				p.height = (unsigned char) (i - p.row + 1);
+			}
+		}
+		return n;
+	}
+
+	/* State::getAllMoves. a move is legal if the cells in front of the piece
+	 * are all free: its front row or column as a mask, shifted next to the piece */
+	static void getAllMoves(const State& s, std::vector<Move>& moves) {
+		moves.clear();
+		Piece pieces[State::MAX_CELLS];
+		const int n = getPieces(s, pieces);
+		const std::uint64_t empty = s.mask(0), exits = s.mask(-1);
+		for (int k = 0; k < n; k++) {
+			const Piece& p = pieces[k];
+			// the master brick (2) can also move onto exits
+			const std::uint64_t blocked = ~(p.label == 2 ? empty | exits : empty);
+			// a row as wide as the piece and a column as high as the piece, at its position
+			const std::uint64_t row = Kernels::first(p.width) << p.col;
+			const std::uint64_t column = rows(0, p.height, 1) << (p.row * W);
+			if (p.row > 0 && !(row << ((p.row - 1) * W) & blocked)) {
+				moves.push_back(Move{ p, Moves::UP });
+			}
+			if (p.row + p.height < H && !(row << ((p.row + p.height) * W) & blocked)) {
+				moves.push_back(Move{ p, Moves::DOWN });
+			}
+			if (p.col > 0 && !(column << (p.col - 1) & blocked)) {
+				moves.push_back(Move{ p, Moves::LEFT });
+			}
+			if (p.col + p.width < W && !(column << (p.col + p.width) & blocked)) {
+				moves.push_back(Move{ p, Moves::RIGHT });
+			}
+		}
+	}
+
+	/* the cells a move changes: "n" cells from "front" (the piece moves onto)
+	 * and from "back" (it leaves), "step" apart */
+	struct Edge {
+		int front, back, step, n;
+	};
+	static Edge edge(const Move& move) {
+		const Piece& p = move.piece;
+		const int corner = p.row * W + p.col;
+		switch (move.dir) {
+		case Moves::UP: return Edge{ corner + offset(Moves::UP), corner + (p.height - 1) * W, 1, p.width };
+		case Moves::DOWN: return Edge{ corner + p.height * W, corner, 1, p.width };
+		case Moves::LEFT: return Edge{ corner + offset(Moves::LEFT), corner + p.width - 1, W, p.height };
+		default: return Edge{ corner + p.width, corner, W, p.height };
+		}
+	}
+
+	// State::applyMove. returns the mask of the front cells that were exits
+	static unsigned long long applyMove(State& s, const Move& move) {
+		const Edge e = edge(move);
+		unsigned long long exits = 0;
+		for (int k = 0, f = e.front, b = e.back; k < e.n; k++, f += e.step, b += e.step) {
+			exits |= (unsigned long long) (s.cells[f] < 0) << k;
+			s.cells[f] = move.piece.label;
+			s.cells[b] = 0;
+		}
+		return exits;
+	}
+
+	// State::undoMove
+	static void undoMove(State& s, const Move& move, const unsigned long long exits) {
+		const Edge e = edge(move);
+		for (int k = 0, f = e.front, b = e.back; k < e.n; k++, f += e.step, b += e.step) {
+			s.cells[f] = (exits >> k) & 1 ? -1 : 0;
+			s.cells[b] = move.piece.label;
+		}
+	}
+
+	static State applyMoveCloning(const State& s, const Move& move) {
+		State clone(s);
+		applyMove(clone, move);
+		return clone;
+	}
+
+	// State::normalize
+	static void normalize(State& s) {
+		signed char remap[128] = { 0 };
+		signed char nextIdx = 3;
+		for (std::uint64_t rest = s.maskAbove(2); rest; rest &= rest - 1) {
+			signed char& c = s.cells[Kernels::lowest(rest)];
+			if (!remap[c]) {
+				remap[c] = nextIdx++;
+			}
+			c = remap[c];
+		}
+	}
+
+	// State::hash
+	static std::size_t hash(const State& s) {
+		std::size_t h = State::sizeHash(W, H);
+		Piece pieces[State::MAX_CELLS];
+		const int n = getPieces(s, pieces);
+		for (int k = 0; k < n; k++) {
+			h ^= State::pieceHash(pieces[k].row * W + pieces[k].col, pieces[k]);
+		}
+		for (std::uint64_t exits = s.mask(-1); exits; exits &= exits - 1) {
+			h ^= State::exitHash(Kernels::lowest(exits));
+		}
+		return h;
+	}
+
+	// State::moveHash
+	static std::size_t moveHash(const State& s, const std::size_t h, const Move& move) {
+		const Piece& p = move.piece;
+		const int corner = p.row * W + p.col;
+		std::size_t next = h ^ State::pieceHash(corner, p);
+		// exits the master brick moves onto are gone for good
+		const Edge e = edge(move);
+		for (int k = 0, f = e.front; k < e.n; k++, f += e.step) {
+			if (s.cells[f] == -1) next ^= State::exitHash(f);
+		}
+		return next ^ State::pieceHash(corner + offset(move.dir), p);
+	}
+};
@@ -0,0 +1,42 @@
+#include "Budget.h"
+
+
+const char* Budget::name(const Exceeded e) {
+	switch (e) {
+	case NONE: return "none";
+	case TIME: return "time";
+	case NODES: return "nodes";
+	case MEMORY: return "memory";
+	case CANCELLED: return "cancelled";
+	default: return "unknown";
+	}
+}
+
+
+Budget::Meter::Meter(const Budget& budget)
+	: budget(budget),
+	deadline(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(budget.seconds))),
+	own(NONE), reason(&own), ticks(0) {
+}
+
+
+Budget::Meter::Meter(Meter& shared)
+	: budget(shared.budget), deadline(shared.deadline), own(NONE), reason(shared.reason), ticks(0) {
+}
+
+
+bool Budget::Meter::stop(const Exceeded e) {
+	int none = NONE;
+	reason->compare_exchange_strong(none, e);
+	return true;
+}
+
+
+bool Budget::Meter::poll(const std::size_t bytes) {
+	if (stopped()) return true;
+	if (budget.cancel && budget.cancel->load(std::memory_order_relaxed)) return stop(CANCELLED);
+	if (budget.bytes && bytes >= budget.bytes) return stop(MEMORY);
+	if (budget.seconds > 0 && std::chrono::steady_clock::now() >= deadline) return stop(TIME);
+	return false;
+}
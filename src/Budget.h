@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+/* Limits of a search, 0 = unlimited. Every algorithm checks them
+ * cooperatively in its hot loop (Budget::Meter) and stops early once one is
+ * exceeded. The Result then tells which (Result::exceeded) and carries the
+ * node count and stats up to that point.
+ * "bytes" limits the memory of the search: the containers that grow with
+ * the states it stores, estimated from their sizes (not the process RSS) */
+struct Budget {
+	// why a search stopped early. NONE: it ran to its end
+	enum Exceeded { NONE, TIME, NODES, MEMORY, CANCELLED };
+
+	// wall time in s
+	double seconds;
+	// # of states the search stores
+	std::size_t nodes;
+	// bytes of the search containers
+	std::size_t bytes;
+	// another thread sets it to stop the search. nullptr = none
+	const std::atomic<bool>* cancel;
+
+	Budget(const double seconds = 0, const std::size_t nodes = 0, const std::size_t bytes = 0,
+		const std::atomic<bool>* cancel = nullptr)
+		: seconds(seconds), nodes(nodes), bytes(bytes), cancel(cancel) {};
+
+	// name of a reason as used in the output ("time", "nodes", "memory", "cancelled")
+	static const char* name(const Exceeded);
+
+	/* checks a Budget in the hot loop of a search. the node count is checked
+	 * on every call, the clock, the token and the memory only every CHECK calls.
+	 * the threads of a parallel search share the reason ("shared", see there)
+	 * and have a Meter each: the first to see the budget exceeded stops them all */
+	class Meter {
+	public:
+		static const unsigned int CHECK = 256;
+
+		// starts the clock
+		explicit Meter(const Budget&);
+		// a Meter of another thread of the same search. shares its clock and reason
+		explicit Meter(Meter& shared);
+
+		/* true if the search must stop (also once stopped by another thread).
+		 * "nodes" is the # of states stored so far, "bytes" a function
+		 * returning the bytes of the search containers */
+		template <typename Bytes>
+		inline bool exceeded(const std::size_t nodes, const Bytes& bytes) {
+			if (budget.nodes && nodes >= budget.nodes) return stop(NODES);
+			if (++ticks < CHECK) return stopped();
+			ticks = 0;
+			return poll(budget.bytes ? bytes() : 0);
+		}
+		// same, checking everything now. for rare points of a search (e.g. the end of a layer)
+		template <typename Bytes>
+		inline bool exceededNow(const std::size_t nodes, const Bytes& bytes) {
+			if (budget.nodes && nodes >= budget.nodes) return stop(NODES);
+			ticks = 0;
+			return poll(budget.bytes ? bytes() : 0);
+		}
+		// same for searches whose memory does not grow with the states (IDA*, IDDFS)
+		inline bool exceeded(const std::size_t nodes) {
+			return exceeded(nodes, []() { return (std::size_t) 0; });
+		}
+		// true once the search was stopped (by any thread)
+		inline bool stopped() const {
+			return reason->load(std::memory_order_relaxed) != NONE;
+		}
+		// why the search was stopped (NONE: it was not)
+		inline Exceeded exceededBy() const {
+			return (Exceeded) reason->load();
+		}
+		// stops the search (first reason wins). returns true
+		bool stop(const Exceeded);
+
+
+	private:
+		const Budget& budget;
+		const std::chrono::steady_clock::time_point deadline;
+		std::atomic<int> own;
+		std::atomic<int>* reason;
+		unsigned int ticks;
+
+		// the checks of every CHECK calls
+		bool poll(const std::size_t bytes);
+	};
+};
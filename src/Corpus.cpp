@@ -0,0 +1,161 @@
+#include "Corpus.h"
+#include <fstream>
+#include <cstdio>
+
+
+namespace {
+	const char MAGIC[8] = { 'S', 'B', 'P', 'C', 'O', 'R', 'P', 0 };
+	const std::uint32_t VERSION = 1;
+
+	/* reads the comma separated integers of one line. false if the line
+	 * holds anything else (a trailing comma and whitespace are fine) */
+	bool parseLine(const std::string& line, std::vector<int>& values) {
+		values.clear();
+		std::size_t i = 0, n = line.size();
+		while (i < n) {
+			while (i < n && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) i++;
+			if (i == n) break;
+			bool negative = line[i] == '-';
+			if (negative) i++;
+			if (i == n || line[i] < '0' || line[i] > '9') return false;
+			int v = 0;
+			for (; i < n && line[i] >= '0' && line[i] <= '9'; i++) {
+				v = v * 10 + (line[i] - '0');
+				if (v > 127) return false;
+			}
+			values.push_back(negative ? -v : v);
+			while (i < n && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) i++;
+			if (i < n && line[i++] != ',') return false;
+		}
+		return true;
+	}
+}
+
+
+const char* Corpus::message(const Error e) {
+	switch (e) {
+		case OK: return "ok";
+		case CANNOT_OPEN: return "cannot open file";
+		case CANNOT_WRITE: return "cannot write file";
+		case BAD_HEADER: return "not a puzzle corpus";
+		case BAD_SIZE: return "corpus file is truncated";
+		case BAD_LEVEL: return "malformed level file";
+		case BAD_BOARD: return "invalid board";
+		case OUT_OF_RANGE: return "board index out of range";
+	}
+	return "unknown error";
+}
+
+
+Corpus::Error Corpus::open(const std::string& path) {
+	boards = 0;
+	records = nullptr;
+	if (!file.open(path)) {
+		return CANNOT_OPEN;
+	}
+	Header header;
+	if (file.size() < sizeof(Header)) {
+		file.close();
+		return BAD_HEADER;
+	}
+	std::memcpy(&header, file.data(), sizeof(Header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+		|| header.recordSize != State::PACKED_SIZE) {
+		file.close();
+		return BAD_HEADER;
+	}
+	if ((file.size() - sizeof(Header)) / State::PACKED_SIZE < header.count) {
+		file.close();
+		return BAD_SIZE;
+	}
+	boards = (std::size_t) header.count;
+	records = file.data() + sizeof(Header);
+	return OK;
+}
+
+
+Corpus::Error Corpus::board(const std::size_t i, State& state) const {
+	if (i >= boards) {
+		return OUT_OF_RANGE;
+	}
+	return state.unpack(records + i * State::PACKED_SIZE) ? OK : BAD_BOARD;
+}
+
+
+Corpus::Error Corpus::readLevel(const std::string& path, State& state) {
+	std::ifstream in(path);
+	if (in.fail()) {
+		return CANNOT_OPEN;
+	}
+	std::string line;
+	std::vector<int> values;
+	// 1st line: width, height
+	if (!std::getline(in, line) || !parseLine(line, values) || values.size() != 2) {
+		return BAD_LEVEL;
+	}
+	int width = values[0], height = values[1];
+	if (width <= 0 || height <= 0 || width * height > State::MAX_CELLS) {
+		return BAD_LEVEL;
+	}
+	// the image State::unpack reads, padded with walls
+	unsigned char image[State::PACKED_SIZE];
+	std::memset(image, 1, sizeof(image));
+	image[0] = (unsigned char) width;
+	image[1] = (unsigned char) height;
+	int row = 0;
+	while (std::getline(in, line)) {
+		if (!parseLine(line, values)) {
+			return BAD_LEVEL;
+		}
+		// blank lines (at the end) are skipped
+		if (values.empty()) continue;
+		if (row == height || (int) values.size() != width) {
+			return BAD_LEVEL;
+		}
+		for (int j = 0; j < width; j++) {
+			image[2 + row * width + j] = (unsigned char) (signed char) values[j];
+		}
+		row++;
+	}
+	if (row != height || !state.unpack(image)) {
+		return BAD_LEVEL;
+	}
+	return OK;
+}
+
+
+Corpus::Error Corpus::convert(const std::vector<std::string>& levels, const std::string& path,
+	std::string* failed) {
+	// write to a temporary file first, so readers never map a partial file
+	std::string tmp = path + ".tmp";
+	std::ofstream out(tmp, std::ios::binary);
+	if (!out) {
+		return CANNOT_WRITE;
+	}
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.recordSize = State::PACKED_SIZE;
+	header.count = levels.size();
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	unsigned char record[State::PACKED_SIZE];
+	for (const std::string& level : levels) {
+		State state;
+		Error e = readLevel(level, state);
+		if (e != OK) {
+			out.close();
+			std::remove(tmp.c_str());
+			if (failed) *failed = level;
+			return e;
+		}
+		state.pack(record);
+		out.write(reinterpret_cast<const char*>(record), sizeof(record));
+	}
+	out.close();
+	if (!out || std::rename(tmp.c_str(), path.c_str()) != 0) {
+		std::remove(tmp.c_str());
+		return CANNOT_WRITE;
+	}
+	return OK;
+}
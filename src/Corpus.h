@@ -0,0 +1,106 @@
+#pragma once
+#include "State.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+#include <iterator>
+#include <cstdint>
+
+/* Binary puzzle corpus: many boards in one file, memory mapped.
+ * The file is a 24 byte header (magic, version, record size, # of boards)
+ * followed by one fixed-size record per board, the packed State image
+ * (State::pack, 64 bytes). Opening a corpus only maps it and checks the
+ * header, boards are read (and checked) when they are accessed, thus
+ * huge corpora open instantly and are paged in as the searches go.
+ *
+ * Nothing here terminates the process: every failure is returned as an
+ * Error. Level text files (see Matrix) are parsed without Matrix, so that
+ * broken files can be reported and skipped as well. */
+class Corpus {
+
+public:
+	enum Error { OK, CANNOT_OPEN, CANNOT_WRITE, BAD_HEADER, BAD_SIZE, BAD_LEVEL, BAD_BOARD, OUT_OF_RANGE };
+	// a board of the corpus, as handed out by the iterator
+	struct Entry {
+		std::size_t index;
+		State state;
+		// OK or BAD_BOARD (state is empty then)
+		Error error;
+	};
+
+	/* forward iterator over all boards. reads each record straight
+	 * from the mapping when it is dereferenced */
+	class iterator : public std::iterator<std::forward_iterator_tag, Entry> {
+	public:
+		iterator(const Corpus* corpus, const std::size_t index) : corpus(corpus), index(index) {};
+		Entry operator*() const {
+			Entry e{ index, State(), OK };
+			e.error = corpus->board(index, e.state);
+			return e;
+		}
+		iterator& operator++() {
+			index++;
+			return *this;
+		}
+		bool operator==(const iterator& other) const {
+			return index == other.index;
+		}
+		bool operator!=(const iterator& other) const {
+			return index != other.index;
+		}
+	private:
+		const Corpus* corpus;
+		std::size_t index;
+	};
+
+
+	// empty corpus (nothing mapped)
+	Corpus() : boards(0), records(nullptr) {};
+	// empty destructor (the mapping is released by MappedFile)
+	~Corpus() {};
+	Corpus(const Corpus&) = delete;
+	Corpus& operator= (const Corpus&) = delete;
+
+
+	// describes an Error for the user
+	static const char* message(const Error);
+	/* maps a corpus file (an open one is closed first). CANNOT_OPEN,
+	 * BAD_HEADER (not a corpus) or BAD_SIZE (truncated file) on failure */
+	Error open(const std::string& path);
+	// # of boards
+	inline std::size_t size() const {
+		return boards;
+	}
+	/* board "i". OUT_OF_RANGE or BAD_BOARD (see State::unpack) on failure,
+	 * "state" is unchanged then. safe to call from many threads */
+	Error board(const std::size_t i, State& state) const;
+	iterator begin() const {
+		return iterator(this, 0);
+	}
+	iterator end() const {
+		return iterator(this, boards);
+	}
+
+	/* parses a level text file (the format Matrix reads: "width,height,"
+	 * then one line of comma separated cells per row). CANNOT_OPEN or BAD_LEVEL */
+	static Error readLevel(const std::string& path, State&);
+	/* converts level text files into one corpus file, in the given order.
+	 * stops at the first level that cannot be read and stores its path in
+	 * "failed" (if given). the file is complete or not there at all */
+	static Error convert(const std::vector<std::string>& levels, const std::string& path,
+		std::string* failed = nullptr);
+
+
+private:
+	struct Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t recordSize;
+		std::uint64_t count;
+	};
+
+	MappedFile file;
+	std::size_t boards;
+	// first record (right after the header)
+	const unsigned char* records;
+};
@@ -1,14 +1,10 @@
 #include "CostNode.h"
 
 
-CostNode::CostNode(const Matrix& m) : Node(m), cost(0) {
+CostNode::CostNode(const State& state) : Node(state), cost(0), g(0) {
 }
 
 
-CostNode::CostNode(const CostNode& other) : Node(other), cost(other.cost) {
+CostNode::CostNode(const State& state, const unsigned int parent, std::pair<int, Moves> trans)
+	: Node(state, parent, trans), cost(0), g(0) {
 }
-
-
-CostNode::CostNode(const Matrix& m, Node* parent, std::pair<int, Moves> trans)
-	: Node(m, parent, trans), cost(0) {
-}
\ No newline at end of file
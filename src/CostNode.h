@@ -5,27 +5,30 @@ class CostNode : public Node {
 
 public:
 	/* construct a root CostNode
-	 * "cost" is 0 by default until set from outside! */
-	CostNode(const Matrix&);
-	// copy constructor
-	CostNode(const CostNode&);
+	 * "cost" and "g" are 0 by default until set from outside! */
+	CostNode(const State&);
 	/* construct a CostNode like a normal (non-root) Node
-	 * "cost" is 0 by default until set from outside! */
-	CostNode(const Matrix& m, Node* parent, std::pair<int, Moves> transition);
-	// empty destructor
-	~CostNode() {};
+	 * "cost" and "g" are 0 by default until set from outside! */
+	CostNode(const State& state, const unsigned int parent, std::pair<int, Moves> transition);
 
 
-	// member variable. only difference between this class and Node
+	// member variables. total cost f(n) and step cost g(n) (depth in tree)
 	int cost;
+	int g;
 
 
-	/* compares two CostNodes by their total cost
+	// open list entry: total cost and index of the CostNode in its NodeArena
+	struct Entry {
+		int cost;
+		unsigned int index;
+	};
+
+	/* compares two open list entries by their total cost
 	* used to sort priority_queue (A*) by increasing cost!
 	* to get decreasing cost, switch ">" to "<" */
 	struct LessThanByTotalCost {
-		bool operator() (const std::shared_ptr<CostNode>& lhs, const std::shared_ptr<CostNode>& rhs) const {
-			return lhs->cost > rhs->cost;
+		bool operator() (const Entry& lhs, const Entry& rhs) const {
+			return lhs.cost > rhs.cost;
 		}
 	};
-};
\ No newline at end of file
+};
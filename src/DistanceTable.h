@@ -0,0 +1,156 @@
+#pragma once
+#include "MappedFile.h"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+/* Open-addressing table from 64 bit keys to distances (of type D).
+ * The storage of the pattern databases and of the state space tables.
+ * Linear probing, load factor below 1/2. Key 0 marks an empty slot, key()
+ * never returns it. States are identified by their key alone.
+ *
+ * On disk: the header of the owner (its magic first, a multiple of 8 bytes),
+ * then per table capacity and count, the keys and the distances. A table is
+ * either filled in memory or mapped from such a file (no copy) */
+template <typename D>
+class DistanceTable {
+
+public:
+	DistanceTable() : capacity(0), count(0), keys(nullptr), distances(nullptr) {};
+	DistanceTable(const DistanceTable&) = delete;
+	DistanceTable& operator= (const DistanceTable&) = delete;
+
+
+	// 64 bit finalizer (splitmix64), as in State.cpp
+	static inline std::uint64_t mix(std::uint64_t x) {
+		x += 0x9E3779B97F4A7C15ULL;
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+		return x ^ (x >> 31);
+	}
+	// table key of a hash or code. never 0
+	static inline std::uint64_t key(const std::uint64_t k) {
+		return k ? k : 1;
+	}
+
+
+	// empty table with room for "n" keys. all slots have the distance "none"
+	void reserve(const std::size_t n, const D none) {
+		capacity = 16;
+		while (capacity < n * 2) capacity <<= 1;
+		count = 0;
+		ownKeys.assign((std::size_t) capacity, 0);
+		ownDistances.assign((std::size_t) capacity, none);
+		keys = ownKeys.data();
+		distances = ownDistances.data();
+		file.close();
+	}
+	// adds a key (of key()) to a reserved table. an existing one is overwritten
+	void insert(const std::uint64_t k, const D distance) {
+		std::size_t i = slot(k);
+		if (ownKeys[i] == 0) count++;
+		ownKeys[i] = k;
+		ownDistances[i] = distance;
+	}
+	// distance of a key. "none" if it is not in the table
+	inline D find(const std::uint64_t k, const D none) const {
+		if (!capacity) return none;
+		std::size_t i = slot(k);
+		return keys[i] == k ? distances[i] : none;
+	}
+	// # of keys in the table
+	std::size_t size() const {
+		return (std::size_t) count;
+	}
+
+
+	/* writes "header" ("size" bytes, magic first) and the tables to a file,
+	 * one after the other. through a temporary file, so readers never map a
+	 * partial one. false on error */
+	static bool save(const std::string& path, const void* header, const std::size_t size,
+		const DistanceTable* const* tables, const std::size_t n) {
+		std::string tmp = path + ".tmp";
+		std::ofstream out(tmp, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(header), (std::streamsize) size);
+		for (std::size_t t = 0; t < n; t++) {
+			const DistanceTable& table = *tables[t];
+			out.write(reinterpret_cast<const char*>(&table.capacity), sizeof(table.capacity));
+			out.write(reinterpret_cast<const char*>(&table.count), sizeof(table.count));
+			out.write(reinterpret_cast<const char*>(table.keys), (std::streamsize) (table.capacity * sizeof(std::uint64_t)));
+			out.write(reinterpret_cast<const char*>(table.distances), (std::streamsize) (table.capacity * sizeof(D)));
+		}
+		out.close();
+		if (!out) {
+			std::remove(tmp.c_str());
+			return false;
+		}
+		return std::rename(tmp.c_str(), path.c_str()) == 0;
+	}
+	// same for this table alone
+	bool save(const std::string& path, const void* header, const std::size_t size) const {
+		const DistanceTable* self = this;
+		return save(path, header, size, &self, 1);
+	}
+	/* uses the table at "data" (written by save, "size" bytes left in the
+	 * file) in place. the memory must outlive the table. returns the # of
+	 * bytes of the table, 0 if it is not a valid table */
+	std::size_t map(const unsigned char* data, const std::size_t size) {
+		file.close();
+		return point(data, size);
+	}
+	/* maps a file of one table written by save() and copies its header out.
+	 * false if it cannot be read, has another magic (8 bytes) or is not a valid table */
+	bool load(const std::string& path, const char* magic, void* header, const std::size_t size) {
+		if (!file.open(path) || file.size() < size || std::memcmp(file.data(), magic, 8) != 0
+			|| point(file.data() + size, file.size() - size) != file.size() - size) {
+			file.close();
+			capacity = count = 0;
+			return false;
+		}
+		std::memcpy(header, file.data(), size);
+		return true;
+	}
+
+
+private:
+	std::uint64_t capacity;
+	std::uint64_t count;
+	const std::uint64_t* keys;
+	const D* distances;
+	// storage of a filled table..
+	std::vector<std::uint64_t> ownKeys;
+	std::vector<D> ownDistances;
+	// ..or of a loaded one
+	MappedFile file;
+
+	// map() without closing the file
+	std::size_t point(const unsigned char* data, const std::size_t size) {
+		const std::size_t start = 2 * sizeof(std::uint64_t);
+		std::uint64_t c, n;
+		if (size < start) return 0;
+		std::memcpy(&c, data, sizeof(c));
+		std::memcpy(&n, data + sizeof(c), sizeof(n));
+		const std::size_t bytes = start + (std::size_t) c * (sizeof(std::uint64_t) + sizeof(D));
+		if (c == 0 || (c & (c - 1)) != 0 || size < bytes) return 0;
+		capacity = c;
+		count = n;
+		ownKeys.clear();
+		ownDistances.clear();
+		// headers are multiples of 8 bytes, capacities of 16: the keys are aligned
+		keys = reinterpret_cast<const std::uint64_t*>(data + start);
+		distances = reinterpret_cast<const D*>(data + start + capacity * sizeof(std::uint64_t));
+		return bytes;
+	}
+	// slot of a key, or of the empty slot where it belongs
+	inline std::size_t slot(const std::uint64_t k) const {
+		std::size_t mask = (std::size_t) capacity - 1;
+		std::size_t i = (std::size_t) mix(k) & mask;
+		while (keys[i] != 0 && keys[i] != k) {
+			i = (i + 1) & mask;
+		}
+		return i;
+	}
+};
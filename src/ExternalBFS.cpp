@@ -0,0 +1,267 @@
+#include "Search.h"
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+/* EXTERNAL MEMORY BREADTH FIRST SEARCH
+ * Counts the layers of the state space like countLayers, but keeps the
+ * layers on disk: every layer is a file of packed, normalized states
+ * (State::pack, 64 bytes each), sorted and free of duplicates.
+ *
+ * Expanding layer d streams its file and collects the children in a buffer
+ * of at most "memory" states. A full buffer is sorted, stripped of
+ * duplicates and written as a run file. The runs are then merged (several
+ * passes if there are many), and the merged stream is compared against the
+ * sorted files of layers d and d-1 on the fly: whatever is found there is
+ * dropped (delayed duplicate detection). The rest is layer d+1.
+ * Like in ParallelBFS.cpp, checking the two previous layers is enough,
+ * because every move can be undone as long as the master brick has not
+ * reached the exit, and solved states are never expanded. Also like there,
+ * boards whose exit the master can cover a part of (State::exitsAtOnce)
+ * check against all layers, which all stay on disk until the end.
+ *
+ * Every call keeps its files in a directory of its own (mkdtemp), so that
+ * several searches can share "directory".
+ *
+ * Memory use is the buffer plus one read buffer per merged file,
+ * independent of the size of the state space. */
+
+namespace {
+
+	// a packed State. ordered by its bytes
+	struct Record {
+		unsigned char bytes[State::PACKED_SIZE];
+
+		bool operator<(const Record& other) const {
+			return std::memcmp(bytes, other.bytes, State::PACKED_SIZE) < 0;
+		}
+		bool operator==(const Record& other) const {
+			return std::memcmp(bytes, other.bytes, State::PACKED_SIZE) == 0;
+		}
+	};
+
+	// # of records read from a file at once
+	const std::size_t READ_BLOCK = 1024;
+	// max # of files merged in one pass
+	const std::size_t FAN_IN = 64;
+
+	// reads a record file front to back, one block at a time
+	class Reader {
+	public:
+		explicit Reader(const std::string& path) : in(path, std::ios::binary), pos(0) {};
+
+		// the next record. false at the end of the file
+		bool next(Record& r) {
+			if (pos == block.size()) {
+				block.resize(READ_BLOCK);
+				in.read(reinterpret_cast<char*>(block.data()), (std::streamsize) (READ_BLOCK * sizeof(Record)));
+				block.resize((std::size_t) in.gcount() / sizeof(Record));
+				pos = 0;
+				if (block.empty()) return false;
+			}
+			r = block[pos++];
+			return true;
+		}
+
+	private:
+		std::ifstream in;
+		std::vector<Record> block;
+		std::size_t pos;
+	};
+
+	/* a sorted record file that is searched by walking along: the records
+	 * asked for must come in ascending order */
+	class SortedFile {
+	public:
+		explicit SortedFile(const std::string& path) : reader(path) {
+			valid = reader.next(current);
+		};
+
+		bool contains(const Record& r) {
+			while (valid && current < r) valid = reader.next(current);
+			return valid && current == r;
+		}
+
+	private:
+		Reader reader;
+		Record current;
+		bool valid;
+	};
+
+	/* merges sorted files into one sorted file without duplicates.
+	 * "filter" drops records found in other sorted files (may be empty).
+	 * returns the # of records written, -1 if the output cannot be written */
+	long long merge(const std::vector<std::string>& inputs, const std::string& output,
+		const std::vector<std::string>& filter) {
+		std::vector<std::unique_ptr<Reader>> readers;
+		// current record of every input, smallest on top
+		std::vector<std::pair<Record, std::size_t>> heap;
+		auto greater = [](const std::pair<Record, std::size_t>& a, const std::pair<Record, std::size_t>& b) {
+			return b.first < a.first;
+		};
+		for (const std::string& path : inputs) {
+			readers.push_back(std::unique_ptr<Reader>(new Reader(path)));
+			Record r;
+			if (readers.back()->next(r)) heap.push_back(std::make_pair(r, readers.size() - 1));
+		}
+		std::make_heap(heap.begin(), heap.end(), greater);
+		std::vector<std::unique_ptr<SortedFile>> known;
+		for (const std::string& path : filter) {
+			known.push_back(std::unique_ptr<SortedFile>(new SortedFile(path)));
+		}
+		std::ofstream out(output, std::ios::binary);
+		long long count = 0;
+		bool first = true;
+		Record last;
+		while (!heap.empty()) {
+			std::pop_heap(heap.begin(), heap.end(), greater);
+			Record r = heap.back().first;
+			std::size_t k = heap.back().second;
+			if (readers[k]->next(heap.back().first)) {
+				std::push_heap(heap.begin(), heap.end(), greater);
+			}
+			else {
+				heap.pop_back();
+			}
+			if (!first && r == last) continue;
+			first = false;
+			last = r;
+			bool seen = false;
+			for (std::unique_ptr<SortedFile>& f : known) {
+				// every filter must advance, so no short-circuit
+				seen = f->contains(r) || seen;
+			}
+			if (seen) continue;
+			out.write(reinterpret_cast<const char*>(r.bytes), sizeof(r.bytes));
+			count++;
+		}
+		out.close();
+		return out ? count : -1;
+	}
+
+	// sorts and dedups a buffer, then writes it to a file. false on error
+	bool writeRun(std::vector<Record>& buffer, const std::string& path) {
+		std::sort(buffer.begin(), buffer.end());
+		buffer.erase(std::unique(buffer.begin(), buffer.end()), buffer.end());
+		std::ofstream out(path, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(buffer.data()), (std::streamsize) (buffer.size() * sizeof(Record)));
+		out.close();
+		buffer.clear();
+		return (bool) out;
+	}
+
+	void removeAll(const std::vector<std::string>& paths) {
+		for (const std::string& p : paths) std::remove(p.c_str());
+	}
+}
+
+
+bool Search::countLayersExternal(const Matrix m, const std::string& directory, LayerCount& count,
+	const std::size_t memory, const bool stopAtGoal, const Budget& budget) const {
+	auto start = std::chrono::high_resolution_clock::now();
+	Budget::Meter meter(budget);
+	count.depth = -1;
+	count.layers.clear();
+	// a directory of this call. removed at the end
+	std::string own = directory + "/sbp-ebfs-XXXXXX";
+	if (!mkdtemp(&own[0])) {
+		return false;
+	}
+	std::string prefix = own + "/";
+	auto layerFile = [&prefix](const int d) { return prefix + "layer" + std::to_string(d) + ".bin"; };
+	const std::size_t limit = memory < 1 ? 1 : memory;
+	std::vector<Record> buffer;
+	buffer.reserve(limit);
+	State root(m);
+	root.normalize();
+	buffer.push_back(Record());
+	root.pack(buffer.back().bytes);
+	if (!writeRun(buffer, layerFile(0))) {
+		std::remove(layerFile(0).c_str());
+		rmdir(own.c_str());
+		return false;
+	}
+	count.layers.push_back(1);
+	bool ok = true, found = root.isSolved();
+	// the layers a child may be known from (see above)
+	const bool reversible = root.exitsAtOnce();
+	if (found) count.depth = 0;
+	std::vector<Move> moves;
+	// states of all complete layers
+	std::size_t stored = 1;
+	for (int d = 0; ok && count.layers.back() > 0 && !(found && stopAtGoal) && !meter.stopped(); d++) {
+		// 1. expand layer d into sorted runs
+		std::vector<std::string> runs;
+		Reader reader(layerFile(d));
+		Record r;
+		State state;
+		while (ok && reader.next(r)) {
+			if (meter.exceeded(stored + buffer.size(), [&]() { return buffer.capacity() * sizeof(Record); })) break;
+			state.unpack(r.bytes);
+			// solved states are not expanded (see above)
+			if (state.isSolved()) continue;
+			state.getAllMoves(moves);
+			for (const Move& move : moves) {
+				State child = state.applyMoveCloning(move);
+				// a solved child is new: it would have been found in an earlier layer
+				if (!found && child.isSolved()) {
+					found = true;
+					count.depth = d + 1;
+				}
+				child.normalize();
+				buffer.push_back(Record());
+				child.pack(buffer.back().bytes);
+				if (buffer.size() == limit) {
+					runs.push_back(prefix + "run" + std::to_string(runs.size()) + ".bin");
+					ok = writeRun(buffer, runs.back());
+				}
+			}
+		}
+		// a layer cut short by the budget is not counted
+		if (meter.stopped()) {
+			buffer.clear();
+			removeAll(runs);
+			break;
+		}
+		if (ok && !buffer.empty()) {
+			runs.push_back(prefix + "run" + std::to_string(runs.size()) + ".bin");
+			ok = writeRun(buffer, runs.back());
+		}
+		// 2. merge the runs until one pass is enough
+		for (int pass = 0; ok && runs.size() > FAN_IN; pass++) {
+			std::vector<std::string> merged;
+			for (std::size_t i = 0; i < runs.size(); i += FAN_IN) {
+				std::vector<std::string> group(runs.begin() + i, runs.begin() + std::min(runs.size(), i + FAN_IN));
+				merged.push_back(prefix + "pass" + std::to_string(pass) + "-" + std::to_string(merged.size()) + ".bin");
+				ok = ok && merge(group, merged.back(), std::vector<std::string>()) >= 0;
+				removeAll(group);
+			}
+			runs.swap(merged);
+		}
+		// 3. the last pass drops the states of layers d and d-1 (of all layers)
+		std::vector<std::string> filter;
+		for (int l = reversible ? std::max(0, d - 1) : 0; l <= d; l++) filter.push_back(layerFile(l));
+		long long n = ok ? merge(runs, layerFile(d + 1), filter) : -1;
+		removeAll(runs);
+		ok = ok && n >= 0;
+		if (!ok) break;
+		// layer d-1 is not needed for duplicate detection anymore
+		if (reversible && d > 0) std::remove(layerFile(d - 1).c_str());
+		count.layers.push_back((std::size_t) n);
+		stored += (std::size_t) n;
+	}
+	for (int d = 0; d <= (int) count.layers.size(); d++) {
+		std::remove(layerFile(d).c_str());
+	}
+	rmdir(own.c_str());
+	count.exceeded = meter.exceededBy();
+	// the last layer is always empty, unless the search stopped at the goal
+	if (count.layers.size() > 1 && count.layers.back() == 0) count.layers.pop_back();
+	auto end = std::chrono::high_resolution_clock::now();
+	count.time = (float(std::chrono::duration_cast
+		<std::chrono::milliseconds>(end - start).count())) / 1000;
+	return ok;
+}
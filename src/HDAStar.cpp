@@ -0,0 +1,328 @@
+#include "Search.h"
+#include "StateMap.h"
+#include "MPSCQueue.h"
+#include <queue>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <climits>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+/* HASH DISTRIBUTED A* (HDA*)
+ * Every state is owned by one worker thread, chosen by its hash. A worker
+ * keeps open list and closed set of its own states only. Generated children
+ * that belong to another worker are sent to it through a lock-free MPSC queue.
+ * The owner computes the heuristic and does the duplicate check.
+ *
+ * Like the sequential A*, states are reopened when they are reached with
+ * a lower g. Unlike it, goals only update the incumbent (best solution so
+ * far). The search ends when no worker has a node with
+ * f < incumbent left and no message is in flight. With an admissible
+ * heuristic the incumbent is then optimal.
+ * Workers without work yield for a while, then park on a condition
+ * variable until a message arrives for them (or the search ends).
+ * Each worker checks the budget with a Meter of its own, estimating the
+ * total from its share (nodes and bytes times the # of workers). The first
+ * to exceed it ends the search for all, without a solution. */
+
+namespace {
+
+	// a node of the HDA* search tree. lives in the node store of its owner
+	struct HNode {
+		State state;
+		const HNode* parent;
+		std::pair<int, Moves> trans;
+		int g;
+		int h;
+	};
+
+	// a generated child on its way to its owner
+	struct Message {
+		State state;
+		std::size_t hash;
+		const HNode* parent;
+		std::pair<int, Moves> trans;
+		int g;
+	};
+
+	// open list entry. "g" detects entries that are outdated by a reopening
+	struct Entry {
+		int f;
+		int g;
+		HNode* node;
+	};
+
+	// lowest f first, ties broken by highest g (deeper nodes first)
+	struct EntryOrder {
+		bool operator() (const Entry& lhs, const Entry& rhs) const {
+			return lhs.f > rhs.f || (lhs.f == rhs.f && lhs.g < rhs.g);
+		}
+	};
+
+	class Worker;
+
+	// state shared by all workers
+	struct Shared {
+		std::vector<std::unique_ptr<Worker>> workers;
+		Search::Heuristic::Function heuristic;
+		const Search::Heuristic::Context* context;
+		// the Meter of the search. the workers share its clock and reason
+		Budget::Meter* meter;
+		// cost of the best solution so far and its node. written under "goalMutex"
+		std::atomic<int> incumbent;
+		const HNode* goal;
+		std::mutex goalMutex;
+		// message counters for termination detection
+		std::atomic<unsigned long long> sent;
+		std::atomic<unsigned long long> received;
+		std::atomic<unsigned int> idle;
+		std::atomic<bool> done;
+
+		Shared() : heuristic(nullptr), context(nullptr), meter(nullptr), incumbent(INT_MAX), goal(nullptr),
+			sent(0), received(0), idle(0), done(false) {};
+
+		// worker index owning a state. uses the high bits, the low ones index the tables
+		unsigned int owner(const std::size_t hash) const {
+			return (unsigned int) ((hash >> 40) % workers.size());
+		}
+	};
+
+	// idle rounds (yields) before a worker parks
+	const unsigned int SPIN = 64;
+	// longest park of an idle worker. only a backstop, senders wake it
+	const std::chrono::milliseconds PARK(1);
+
+	class Worker {
+	public:
+		Worker(Shared& shared, const unsigned int id)
+			: shared(shared), id(id), isIdle(false), meter(*shared.meter), parked(false) {};
+
+		MPSCQueue<Message> inbox;
+		// all nodes ever created by this worker (stable addresses)
+		std::deque<HNode> nodes;
+		// counters and timers of this worker, merged into the Result at the end
+		Stats stats;
+
+		void run() {
+			std::vector<Move> moves;
+			unsigned int idleRounds = 0;
+			while (!shared.done.load()) {
+				bool worked = receive();
+				if (!open.empty()) {
+					if (isIdle) setIdle(false);
+					if (exceeded()) {
+						finish();
+						break;
+					}
+					expand(moves);
+					idleRounds = 0;
+					continue;
+				}
+				if (worked) {
+					idleRounds = 0;
+					continue;
+				}
+				// nothing to do: go idle, check if everybody is, else wait for messages
+				if (!isIdle) setIdle(true);
+				if (checkTermination()) break;
+				if (++idleRounds < SPIN) std::this_thread::yield();
+				else park();
+			}
+		}
+		// wakes the worker if it is parked. called after a push to its inbox
+		void wake() {
+			// pairs with the fence in park(): either it sees the message or we see "parked"
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (parked.load()) {
+				std::lock_guard<std::mutex> lock(parkMutex);
+				waiting.notify_one();
+			}
+		}
+
+	private:
+		Shared& shared;
+		const unsigned int id;
+		bool isIdle;
+		Budget::Meter meter;
+		std::priority_queue<Entry, std::vector<Entry>, EntryOrder> open;
+		// state -> node (closed and open states)
+		StateMap<HNode*> table;
+		// set while the worker waits on "waiting"
+		std::atomic<bool> parked;
+		std::mutex parkMutex;
+		std::condition_variable waiting;
+
+		// waits until a message arrives or the search is done
+		void park() {
+			std::unique_lock<std::mutex> lock(parkMutex);
+			parked.store(true);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (inbox.empty() && !shared.done.load()) {
+				waiting.wait_for(lock, PARK);
+			}
+			parked.store(false);
+		}
+		// ends the search and wakes all parked workers
+		void finish() {
+			shared.done.store(true);
+			for (const std::unique_ptr<Worker>& w : shared.workers) {
+				std::lock_guard<std::mutex> lock(w->parkMutex);
+				w->waiting.notify_one();
+			}
+		}
+
+		// the budget, for all workers as if they stored as much as this one
+		bool exceeded() {
+			const std::size_t n = shared.workers.size();
+			return meter.exceeded(nodes.size() * n, [&]() {
+				return (nodes.size() * sizeof(HNode) + table.bytes() + open.size() * sizeof(Entry)) * n;
+			});
+		}
+
+		void setIdle(const bool value) {
+			isIdle = value;
+			if (value) shared.idle++;
+			else shared.idle--;
+		}
+
+		// adds a state to the own open list if it is new or reached cheaper
+		void add(const State& state, const std::size_t hash, const HNode* parent,
+			const std::pair<int, Moves>& trans, const int g) {
+			HNode** known = table.find(state, hash);
+			HNode* node;
+			if (known) {
+				node = *known;
+				if (node->g <= g) {
+					STATS(stats.duplicates++);
+					return; // not better
+				}
+				node->g = g;
+				node->parent = parent;
+				node->trans = trans;
+			}
+			else {
+				nodes.push_back(HNode{ state, parent, trans, g, 0 });
+				node = &nodes.back();
+				STATS_TIMED(stats, NORMALIZE, node->state.normalize());
+				node->h = STATS_TIMED(stats, HEURISTIC, shared.heuristic(node->state, *shared.context));
+				table.insert(&node->state, hash, node);
+			}
+			STATS_TIMED(stats, QUEUE, open.push(Entry{ g + node->h, g, node }));
+			STATS(stats.open(open.size()));
+		}
+
+		// processes all messages in the inbox. true if there were any
+		bool receive() {
+			Message msg;
+			bool any = false;
+			while (inbox.pop(msg)) {
+				if (isIdle) setIdle(false);
+				add(msg.state, msg.hash, msg.parent, msg.trans, msg.g);
+				shared.received++;
+				any = true;
+			}
+			return any;
+		}
+
+		void expand(std::vector<Move>& moves) {
+			Entry e = open.top();
+			STATS_TIMED(stats, QUEUE, open.pop());
+			HNode* node = e.node;
+			// outdated entry (node was reopened) or cannot beat the incumbent
+			if (e.g != node->g || e.f >= shared.incumbent.load()) return;
+			if (node->state.isSolved()) {
+				std::lock_guard<std::mutex> lock(shared.goalMutex);
+				if (node->g < shared.incumbent.load()) {
+					shared.incumbent.store(node->g);
+					shared.goal = node;
+				}
+				return;
+			}
+			std::size_t hash = STATS_TIMED(stats, HASH, node->state.hash());
+			STATS_TIMED(stats, MOVEGEN, node->state.getAllMoves(moves));
+			STATS(stats.expand(moves.size()));
+			for (const Move& move : moves) {
+				std::size_t childHash = STATS_TIMED(stats, HASH, node->state.moveHash(hash, move));
+				State child = node->state.applyMoveCloning(move);
+				std::pair<int, Moves> trans(move.piece.label, move.dir);
+				unsigned int to = shared.owner(childHash);
+				if (to == id) {
+					add(child, childHash, node, trans, node->g + 1);
+				}
+				else {
+					// count first: the message must never be "in flight" uncounted
+					shared.sent++;
+					shared.workers[to]->inbox.push(Message{ child, childHash, node, trans, node->g + 1 });
+					shared.workers[to]->wake();
+				}
+			}
+		}
+
+		/* all workers idle and every sent message processed means nothing
+		 * can happen anymore. true if the search is done.
+		 * "received" is read first, "sent" last. a worker only leaves idle
+		 * by receiving a message, and received <= sent at all times. so a
+		 * worker that got busy (and maybe idle again) after the first read
+		 * received a message that "sent" counts: sent > the "received" read */
+		bool checkTermination() {
+			unsigned long long received = shared.received.load();
+			if (shared.idle.load() != shared.workers.size()) return false;
+			if (shared.sent.load() != received) return false;
+			finish();
+			return true;
+		}
+	};
+}
+
+
+// HASH DISTRIBUTED A* SEARCH
+void Search::hdastar(const State& m, const Heuristic::Function heuristic, const Heuristic::Context& context,
+	unsigned int threads, Budget::Meter& meter, Result& result) const {
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+		if (threads == 0) threads = 1;
+	}
+	Shared shared;
+	shared.heuristic = heuristic;
+	shared.context = &context;
+	shared.meter = &meter;
+	for (unsigned int i = 0; i < threads; i++) {
+		shared.workers.push_back(std::unique_ptr<Worker>(new Worker(shared, i)));
+	}
+	// root goes to its owner like any other state
+	State root(m);
+	std::size_t hash = root.hash();
+	shared.sent++;
+	shared.workers[shared.owner(hash)]->inbox.push(
+		Message{ root, hash, nullptr, std::pair<int, Moves>(0, Moves::UP), 0 });
+	// run
+	std::vector<std::thread> pool;
+	for (unsigned int i = 0; i < threads; i++) {
+		pool.push_back(std::thread(&Worker::run, shared.workers[i].get()));
+	}
+	for (std::thread& t : pool) {
+		t.join();
+	}
+	// collect results
+	for (const std::unique_ptr<Worker>& w : shared.workers) {
+		result.nodecount += (int) w->nodes.size();
+		STATS(w->stats.closed(w->nodes.size()));
+		STATS(result.stats.merge(w->stats));
+	}
+	// the incumbent of a stopped search may not be optimal
+	const HNode* goal = meter.stopped() ? nullptr : shared.goal;
+	if (goal) {
+		// copy the solution path out of the worker node stores
+		std::vector<const HNode*> path;
+		for (const HNode* n = goal; n; n = n->parent) {
+			path.push_back(n);
+		}
+		result.path = Path(path.back()->state);
+		for (std::size_t k = path.size() - 1; k > 0; k--) {
+			result.path.add(path[k]->state, path[k - 1]->trans.first, path[k - 1]->trans.second);
+		}
+		result.found = true;
+	}
+}
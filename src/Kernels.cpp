@@ -0,0 +1,186 @@
+#include "Kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SBP_X86
+#include <immintrin.h>
+#endif
+
+
+namespace {
+	/* SCALAR */
+
+	std::uint64_t scalarEqualTo(const signed char* cells, const int n, const signed char value) {
+		std::uint64_t mask = 0;
+		for (int i = 0; i < n; i++) {
+			mask |= (std::uint64_t) (cells[i] == value) << i;
+		}
+		return mask;
+	}
+
+	std::uint64_t scalarGreaterThan(const signed char* cells, const int n, const signed char value) {
+		std::uint64_t mask = 0;
+		for (int i = 0; i < n; i++) {
+			mask |= (std::uint64_t) (cells[i] > value) << i;
+		}
+		return mask;
+	}
+
+	std::uint64_t scalarCompare(const signed char* a, const signed char* b, const int n) {
+		std::uint64_t mask = 0;
+		for (int i = 0; i < n; i++) {
+			mask |= (std::uint64_t) (a[i] == b[i]) << i;
+		}
+		return mask;
+	}
+
+#ifdef SBP_X86
+	/* SSE2. 16 cells per compare. the last block overlaps the one before
+	 * (ends at cell n), thus no cell is read past the end */
+
+	__attribute__((target("sse2")))
+	inline __m128i load16(const signed char* p) {
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	}
+
+	__attribute__((target("sse2")))
+	inline std::uint64_t bits16(const __m128i cmp, const int shift) {
+		return (std::uint64_t) (unsigned int) _mm_movemask_epi8(cmp) << shift;
+	}
+
+	__attribute__((target("sse2")))
+	std::uint64_t sseEqualTo(const signed char* cells, const int n, const signed char value) {
+		if (n < 16) return scalarEqualTo(cells, n, value);
+		const __m128i v = _mm_set1_epi8(value);
+		std::uint64_t mask = 0;
+		int i = 0;
+		for (; i + 16 <= n; i += 16) mask |= bits16(_mm_cmpeq_epi8(load16(cells + i), v), i);
+		if (i < n) mask |= bits16(_mm_cmpeq_epi8(load16(cells + n - 16), v), n - 16);
+		return mask;
+	}
+
+	__attribute__((target("sse2")))
+	std::uint64_t sseGreaterThan(const signed char* cells, const int n, const signed char value) {
+		if (n < 16) return scalarGreaterThan(cells, n, value);
+		const __m128i v = _mm_set1_epi8(value);
+		std::uint64_t mask = 0;
+		int i = 0;
+		for (; i + 16 <= n; i += 16) mask |= bits16(_mm_cmpgt_epi8(load16(cells + i), v), i);
+		if (i < n) mask |= bits16(_mm_cmpgt_epi8(load16(cells + n - 16), v), n - 16);
+		return mask;
+	}
+
+	__attribute__((target("sse2")))
+	std::uint64_t sseCompare(const signed char* a, const signed char* b, const int n) {
+		if (n < 16) return scalarCompare(a, b, n);
+		std::uint64_t mask = 0;
+		int i = 0;
+		for (; i + 16 <= n; i += 16) mask |= bits16(_mm_cmpeq_epi8(load16(a + i), load16(b + i)), i);
+		if (i < n) mask |= bits16(_mm_cmpeq_epi8(load16(a + n - 16), load16(b + n - 16)), n - 16);
+		return mask;
+	}
+
+	/* AVX2. two (overlapping) blocks of 32 cells cover a board of 32 to 64
+	 * cells. smaller boards take the SSE2 kernels */
+
+	__attribute__((target("avx2")))
+	inline __m256i load32(const signed char* p) {
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	}
+
+	__attribute__((target("avx2")))
+	inline std::uint64_t bits32(const __m256i cmp, const int shift) {
+		return (std::uint64_t) (unsigned int) _mm256_movemask_epi8(cmp) << shift;
+	}
+
+	__attribute__((target("avx2")))
+	std::uint64_t avxEqualTo(const signed char* cells, const int n, const signed char value) {
+		if (n < 32) return sseEqualTo(cells, n, value);
+		const __m256i v = _mm256_set1_epi8(value);
+		return bits32(_mm256_cmpeq_epi8(load32(cells), v), 0)
+			| bits32(_mm256_cmpeq_epi8(load32(cells + n - 32), v), n - 32);
+	}
+
+	__attribute__((target("avx2")))
+	std::uint64_t avxGreaterThan(const signed char* cells, const int n, const signed char value) {
+		if (n < 32) return sseGreaterThan(cells, n, value);
+		const __m256i v = _mm256_set1_epi8(value);
+		return bits32(_mm256_cmpgt_epi8(load32(cells), v), 0)
+			| bits32(_mm256_cmpgt_epi8(load32(cells + n - 32), v), n - 32);
+	}
+
+	__attribute__((target("avx2")))
+	std::uint64_t avxCompare(const signed char* a, const signed char* b, const int n) {
+		if (n < 32) return sseCompare(a, b, n);
+		return bits32(_mm256_cmpeq_epi8(load32(a), load32(b)), 0)
+			| bits32(_mm256_cmpeq_epi8(load32(a + n - 32), load32(b + n - 32)), n - 32);
+	}
+
+	const Kernels::Set sets[Kernels::LEVELS] = {
+		{ scalarEqualTo, scalarGreaterThan, scalarCompare },
+		{ sseEqualTo, sseGreaterThan, sseCompare },
+		{ avxEqualTo, avxGreaterThan, avxCompare },
+	};
+#else
+	// scalar only. the other levels are never supported
+	const Kernels::Set sets[Kernels::LEVELS] = {
+		{ scalarEqualTo, scalarGreaterThan, scalarCompare },
+		{ scalarEqualTo, scalarGreaterThan, scalarCompare },
+		{ scalarEqualTo, scalarGreaterThan, scalarCompare },
+	};
+#endif
+
+	// selects the best kernels before main (the scalar ones until then)
+	struct Startup {
+		Startup() {
+			Kernels::select(Kernels::best());
+		}
+	} startup;
+}
+
+
+const Kernels::Set* Kernels::active = &sets[SCALAR];
+
+
+bool Kernels::supported(const Level level) {
+	switch (level) {
+	case SCALAR: return true;
+#ifdef SBP_X86
+	case SSE2: __builtin_cpu_init(); return __builtin_cpu_supports("sse2");
+	case AVX2: __builtin_cpu_init(); return __builtin_cpu_supports("avx2");
+#endif
+	default: return false;
+	}
+}
+
+
+Kernels::Level Kernels::best() {
+	for (int level = LEVELS - 1; level > SCALAR; level--) {
+		if (supported((Level) level)) return (Level) level;
+	}
+	return SCALAR;
+}
+
+
+const Kernels::Set& Kernels::get(const Level level) {
+	return sets[level];
+}
+
+
+const char* Kernels::name(const Level level) {
+	switch (level) {
+	case SCALAR: return "scalar";
+	case SSE2: return "sse2";
+	case AVX2: return "avx2";
+	default: return "unknown";
+	}
+}
+
+
+void Kernels::select(const Level level) {
+	active = &sets[supported(level) ? level : SCALAR];
+}
+
+
+Kernels::Level Kernels::selected() {
+	return (Level) (active - sets);
+}
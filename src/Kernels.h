@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+
+/* Vectorized scans over the cells of a board (one byte per cell, at most 64).
+ * The scans return bit masks, bit i = cell i, so that callers can combine them
+ * with masks of board regions (rectangle) and count cells with a popcount.
+ * Every kernel exists as plain scalar code, with SSE2 and with AVX2. The best
+ * level the CPU supports is selected once at startup (runtime dispatch),
+ * thus the binary needs no -mavx2 and runs on any CPU. On other than x86
+ * only the scalar kernels are compiled */
+class Kernels {
+
+public:
+	// instruction set of an implementation
+	enum Level { SCALAR, SSE2, AVX2, LEVELS };
+
+	// the kernels of one level. all take the # of cells n (at most 64)
+	struct Set {
+		// bit i is set if cells[i] == value
+		std::uint64_t (*equalTo)(const signed char* cells, const int n, const signed char value);
+		// bit i is set if cells[i] > value
+		std::uint64_t (*greaterThan)(const signed char* cells, const int n, const signed char value);
+		// bit i is set if a[i] == b[i]
+		std::uint64_t (*compare)(const signed char* a, const signed char* b, const int n);
+	};
+
+	// true if the CPU runs the kernels of a level
+	static bool supported(const Level);
+	// the highest supported level
+	static Level best();
+	// kernels of a level (must be supported)
+	static const Set& get(const Level);
+	// name of a level ("scalar", "sse2", "avx2")
+	static const char* name(const Level);
+	/* makes the kernels of a level the active ones (the best by default).
+	 * for benchmarks and tests only. NOT while searches are running! */
+	static void select(const Level);
+	// level of the active kernels
+	static Level selected();
+
+	// active kernels
+	static inline std::uint64_t equalTo(const signed char* cells, const int n, const signed char value) {
+		return active->equalTo(cells, n, value);
+	}
+	static inline std::uint64_t greaterThan(const signed char* cells, const int n, const signed char value) {
+		return active->greaterThan(cells, n, value);
+	}
+	static inline std::uint64_t compare(const signed char* a, const signed char* b, const int n) {
+		return active->compare(a, b, n);
+	}
+
+	// bit mask of the first n cells
+	static inline std::uint64_t first(const int n) {
+		return n >= 64 ? ~0ULL : (1ULL << n) - 1;
+	}
+	// bit mask of the cells of rows [top, bottom) and columns [left, right) of a board. 0 if empty
+	static inline std::uint64_t rectangle(const int width, const int top, const int bottom,
+		const int left, const int right) {
+		if (top >= bottom || left >= right) return 0;
+		std::uint64_t row = first(right - left) << left, mask = 0;
+		for (int i = top; i < bottom; i++) mask |= row << (i * width);
+		return mask;
+	}
+	// # of set bits
+	static inline int count(const std::uint64_t mask) {
+		return __builtin_popcountll(mask);
+	}
+	// index of the lowest set bit. mask must not be 0
+	static inline int lowest(const std::uint64_t mask) {
+		return __builtin_ctzll(mask);
+	}
+	// index of the highest set bit. mask must not be 0
+	static inline int highest(const std::uint64_t mask) {
+		return 63 - __builtin_clzll(mask);
+	}
+
+
+private:
+	static const Set* active;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <utility>
+
+/* Unbounded lock-free multi producer, single consumer queue
+ * (D. Vyukov's intrusive MPSC algorithm with a stub cell).
+ * Any thread may push, only one thread (the owner) may pop.
+ * push is wait-free (one atomic exchange). T must be default constructible */
+template <typename T>
+class MPSCQueue {
+
+public:
+	MPSCQueue() {
+		Cell* stub = new Cell();
+		head.store(stub);
+		tail = stub;
+	}
+	~MPSCQueue() {
+		T value;
+		while (pop(value));
+		delete tail;
+	}
+	MPSCQueue(const MPSCQueue&) = delete;
+	MPSCQueue& operator= (const MPSCQueue&) = delete;
+
+
+	// adds a value. callable from any thread
+	void push(T value) {
+		Cell* c = new Cell();
+		c->value = std::move(value);
+		Cell* prev = head.exchange(c, std::memory_order_acq_rel);
+		prev->next.store(c, std::memory_order_release);
+	}
+	// takes the oldest value. owner thread only. false if the queue is (seemingly) empty
+	bool pop(T& value) {
+		Cell* next = tail->next.load(std::memory_order_acquire);
+		if (!next) {
+			return false;
+		}
+		value = std::move(next->value);
+		delete tail;
+		tail = next; // "next" is the new stub
+		return true;
+	}
+	// true if pop would find nothing. owner thread only
+	bool empty() const {
+		return !tail->next.load(std::memory_order_acquire);
+	}
+
+
+private:
+	struct Cell {
+		std::atomic<Cell*> next;
+		T value;
+
+		Cell() : next(nullptr), value() {};
+	};
+	// producers append here..
+	std::atomic<Cell*> head;
+	// ..the consumer takes from here
+	Cell* tail;
+};
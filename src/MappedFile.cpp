@@ -0,0 +1,46 @@
+#include "MappedFile.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+MappedFile::MappedFile() : bytes(nullptr), length(0) {
+}
+
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+
+bool MappedFile::open(const std::string& path) {
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	void* p = mmap(nullptr, (std::size_t) info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// the mapping stays valid without the descriptor
+	::close(fd);
+	if (p == MAP_FAILED) {
+		return false;
+	}
+	bytes = static_cast<const unsigned char*>(p);
+	length = (std::size_t) info.st_size;
+	return true;
+}
+
+
+void MappedFile::close() {
+	if (bytes) {
+		munmap(const_cast<unsigned char*>(bytes), length);
+	}
+	bytes = nullptr;
+	length = 0;
+}
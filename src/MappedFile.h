@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+/* Read-only memory mapping of a whole file (POSIX mmap).
+ * The contents are paged in on demand and shared between processes,
+ * nothing is copied. The mapping lives as long as the object */
+class MappedFile {
+
+public:
+	MappedFile();
+	// unmaps the file
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator= (const MappedFile&) = delete;
+
+
+	/* maps a file (an already mapped one is unmapped first).
+	 * returns false if the file cannot be opened or mapped */
+	bool open(const std::string& path);
+	// unmaps the file. data() is nullptr afterwards
+	void close();
+	// first byte of the file (nullptr if nothing is mapped)
+	inline const unsigned char* data() const {
+		return bytes;
+	}
+	// # of bytes of the file
+	inline std::size_t size() const {
+		return length;
+	}
+
+
+private:
+	const unsigned char* bytes;
+	std::size_t length;
+};
@@ -6,6 +6,11 @@ Matrix::Matrix()
 }
 
 
+Matrix::Matrix(const int width, const int height)
+	: width(width), height(height), array(new int[width * height]()) {
+}
+
+
 Matrix::Matrix(const Matrix& other) {
 	swap(*this, other);
 }
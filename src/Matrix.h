@@ -14,6 +14,8 @@ public:
 	Matrix();
 	// copy constructor
 	Matrix(const Matrix&);
+	// empty Matrix of a given size (width, height). all cells are 0
+	Matrix(const int, const int);
 	// "from file" constructor. loads file and turns it into Matrix
 	Matrix(const std::string);
 	// destructor
@@ -79,7 +81,7 @@ public:
 	}
 
 	// compares two Matrix objects for equality
-	inline bool operator==(Matrix const& other) {
+	inline bool operator==(Matrix const& other) const {
 		// sanity check
 		if (width != other.width || height != other.height) {
 			return false;
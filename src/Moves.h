@@ -2,7 +2,7 @@
 #include <iostream>
 
 // enumeration of possible moves for any piece
-enum class Moves {
+enum class Moves : unsigned char {
 	UP, DOWN, LEFT, RIGHT
 };
 
@@ -27,4 +27,14 @@ inline std::ostream& operator<<(
 	default: os << "UNKNOWN";
 	}
 	return os;
+}
+
+// the move that undoes a move (UP <-> DOWN, LEFT <-> RIGHT)
+inline Moves inverse(const Moves m) {
+	switch (m) {
+	case Moves::UP: return Moves::DOWN;
+	case Moves::DOWN: return Moves::UP;
+	case Moves::LEFT: return Moves::RIGHT;
+	default: return Moves::LEFT;
+	}
 }
\ No newline at end of file
@@ -1,34 +1,22 @@
 #pragma once
-#include <memory>
-#include "Matrix.h"
+#include "State.h"
+#include "NodeArena.h"
 
 
 class Node {
 
 public:
-	//Node() {};
 	// root node..
-	Node(const Matrix&);
-	// ..all other nodes
-	Node(const Matrix& m, Node* parent, std::pair<int, Moves> transition);
-	// cpy constructor
-	Node(const Node&);
-	// empty destructor
-	~Node() {};
+	Node(const State&);
+	// ..all other nodes. "parent" is the index of the parent node in the NodeArena
+	Node(const State& state, const unsigned int parent, std::pair<int, Moves> transition);
 
 
-	// Matrix (current state of the puzzle)
-	Matrix m;
-	// reference to the parent node (only nullptr for root node)
-	Node* parent;
+	// current state of the puzzle
+	State state;
+	// index of the parent node in its NodeArena (NodeArena::NONE for root node)
+	unsigned int parent;
 	// transition (move on a piece) that stood between parent and this node
-	std::pair<int, Moves> trans;
+	std::pair<signed char, Moves> trans;
 
-
-	/* copy & swap idiom
-	* copy constructor and assign operator */
-	friend void swap(Node&, const Node&);
-	// for backtracing step cost (depth in tree)
-	const int getParentCount() const;
-
-};
\ No newline at end of file
+};
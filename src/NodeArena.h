@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <new>
+#include <type_traits>
+
+/* Per-search storage for search tree nodes.
+ * Nodes live in contiguous chunks of 4096 and refer to each other by
+ * 32 bit index instead of pointer or shared_ptr. A node never moves,
+ * so pointers to it (e.g. in a StateSet) stay valid while the arena lives.
+ * Nodes are never destroyed one by one. The arena frees its chunks at once */
+template <typename T>
+class NodeArena {
+	static_assert(std::is_trivially_destructible<T>::value,
+		"NodeArena never runs destructors");
+
+public:
+	// index of "no node" (parent of the root node)
+	static const unsigned int NONE = 0xFFFFFFFF;
+
+
+	NodeArena() : count(0) {};
+	~NodeArena() {
+		for (T* chunk : chunks) {
+			::operator delete(chunk);
+		}
+	}
+	NodeArena(const NodeArena&) = delete;
+	NodeArena& operator= (const NodeArena&) = delete;
+
+
+	// copies a node into the arena and returns its index
+	unsigned int add(const T& node) {
+		if ((count >> CHUNK_BITS) == chunks.size()) {
+			chunks.push_back(static_cast<T*>(::operator new(sizeof(T) << CHUNK_BITS)));
+		}
+		new (&(*this)[count]) T(node);
+		return count++;
+	}
+	// node at an index
+	inline T& operator[](const unsigned int idx) {
+		return chunks[idx >> CHUNK_BITS][idx & CHUNK_MASK];
+	}
+	inline const T& operator[](const unsigned int idx) const {
+		return chunks[idx >> CHUNK_BITS][idx & CHUNK_MASK];
+	}
+	// # of nodes
+	const unsigned int size() const {
+		return count;
+	}
+	// memory held by the chunks
+	const std::size_t bytes() const {
+		return chunks.size() * (sizeof(T) << CHUNK_BITS);
+	}
+	/* drops all nodes with index >= n (keeps the memory).
+	 * lets depth first searches use the arena as a stack */
+	void truncate(const unsigned int n) {
+		if (n < count) count = n;
+	}
+	// # of ancestors of a node (depth in the tree)
+	const int depth(unsigned int idx) const {
+		int d = 0;
+		while ((*this)[idx].parent != NONE) {
+			idx = (*this)[idx].parent;
+			d++;
+		}
+		return d;
+	}
+
+
+private:
+	static const unsigned int CHUNK_BITS = 12;
+	static const unsigned int CHUNK_MASK = (1u << CHUNK_BITS) - 1;
+	std::vector<T*> chunks;
+	unsigned int count;
+};
@@ -0,0 +1,97 @@
+#pragma once
+#include "CostNode.h"
+#include <queue>
+#include <vector>
+
+/* Open lists for A*. Both hold node indices (into the NodeArena of the
+ * search) keyed by their total cost f and share one interface:
+ * push(cost, index), top() (index of a node with the lowest cost), pop(),
+ * empty() and size(). The search is a template over the open list. */
+
+
+/* binary heap (std::priority_queue). O(log n) push and pop.
+ * order of nodes with equal cost is unspecified */
+class HeapOpenList {
+
+public:
+	inline void push(const int cost, const unsigned int index) {
+		heap.push(CostNode::Entry{ cost, index });
+	}
+	inline unsigned int top() const {
+		return heap.top().index;
+	}
+	inline void pop() {
+		heap.pop();
+	}
+	inline bool empty() const {
+		return heap.empty();
+	}
+	inline std::size_t size() const {
+		return heap.size();
+	}
+
+
+private:
+	std::priority_queue<CostNode::Entry, std::vector<CostNode::Entry>, CostNode::LessThanByTotalCost> heap;
+};
+
+
+/* array of buckets, one per f value. The costs are small integers
+ * (g + h, both bounded by the solution length), so push and pop are O(1)
+ * (amortized: pop skips empty buckets up to the next lowest cost).
+ * Each bucket is a contiguous vector of indices, used as a stack: among
+ * nodes with equal f, the one pushed last is popped first (LIFO), which
+ * prefers deeper nodes. f may drop below the current minimum (inconsistent
+ * heuristics) or below the first cost pushed; the array grows on both ends */
+class BucketOpenList {
+
+public:
+	BucketOpenList() : offset(0), lowest(0), count(0) {};
+
+
+	inline void push(const int cost, const unsigned int index) {
+		if (buckets.empty()) {
+			offset = cost;
+		}
+		else if (cost < offset) {
+			// prepend buckets, so that cost gets index 0
+			buckets.insert(buckets.begin(), offset - cost, std::vector<unsigned int>());
+			lowest += offset - cost;
+			offset = cost;
+		}
+		std::size_t b = cost - offset;
+		if (b >= buckets.size()) {
+			buckets.resize(b + 1);
+		}
+		buckets[b].push_back(index);
+		if (count == 0 || b < lowest) {
+			lowest = b;
+		}
+		count++;
+	}
+	// must not be called on an empty list
+	inline unsigned int top() {
+		while (buckets[lowest].empty()) lowest++;
+		return buckets[lowest].back();
+	}
+	inline void pop() {
+		while (buckets[lowest].empty()) lowest++;
+		buckets[lowest].pop_back();
+		count--;
+	}
+	inline bool empty() const {
+		return count == 0;
+	}
+	inline std::size_t size() const {
+		return count;
+	}
+
+
+private:
+	// buckets[i] holds the nodes with cost offset + i
+	std::vector<std::vector<unsigned int>> buckets;
+	int offset;
+	// no bucket below this index holds a node
+	std::size_t lowest;
+	std::size_t count;
+};
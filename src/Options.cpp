@@ -0,0 +1,54 @@
+#include "Options.h"
+#include <iostream>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+
+using namespace std;
+
+
+bool Options::parseCount(const string& value, const unsigned long long max, unsigned long long& n) {
+	if (value.empty() || !isdigit((unsigned char) value[0])) return false;
+	size_t end;
+	try {
+		n = stoull(value, &end);
+	}
+	catch (const exception&) {
+		return false;
+	}
+	return end == value.size() && n > 0 && n <= max;
+}
+
+
+bool Options::parseSeconds(const string& value, double& seconds) {
+	if (value.empty() || isspace((unsigned char) value[0])) return false;
+	size_t end;
+	try {
+		seconds = stod(value, &end);
+	}
+	catch (const exception&) {
+		return false;
+	}
+	return end == value.size() && isfinite(seconds) && seconds > 0;
+}
+
+
+int Options::invalidValue(const string& arg, const string& value) {
+	cout << "Invalid value '" << value << "' for '" << arg << "' (must be a positive number)" << endl;
+	return 1;
+}
+
+
+bool Options::budgetOption(const string& arg, const string& value, Budget& budget, bool& valid) {
+	if (arg == "--time-limit") {
+		valid = parseSeconds(value, budget.seconds);
+		return true;
+	}
+	if (arg == "--node-limit" || arg == "--memory-limit") {
+		unsigned long long n;
+		valid = parseCount(value, SIZE_MAX, n);
+		if (valid) (arg == "--node-limit" ? budget.nodes : budget.bytes) = (size_t) n;
+		return true;
+	}
+	return false;
+}
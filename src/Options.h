@@ -0,0 +1,22 @@
+#pragma once
+#include "Budget.h"
+#include <string>
+
+/* Parsing of command line option values, shared by sbp (main.cpp) and
+ * sbp_bench. A value is rejected as a whole: no sign, no trailing
+ * characters, nothing out of range */
+class Options {
+
+public:
+	/* parses the value of a count option (threads, limits, repeats). false
+	 * unless it is a whole number from 1 to "max", without sign or anything after it */
+	static bool parseCount(const std::string& value, const unsigned long long max, unsigned long long& n);
+	// same for a number of seconds. any positive finite number
+	static bool parseSeconds(const std::string& value, double& seconds);
+	// prints the message of a value parseCount or parseSeconds rejects. returns 1 (exit code)
+	static int invalidValue(const std::string& arg, const std::string& value);
+	/* the budget options of every mode: --time-limit, --node-limit and
+	 * --memory-limit (see Budget.h). false if "arg" is none of them,
+	 * "valid" tells if its value parses */
+	static bool budgetOption(const std::string& arg, const std::string& value, Budget& budget, bool& valid);
+};
@@ -0,0 +1,237 @@
+#include "Search.h"
+#include "StateSet.h"
+#include "ThreadPool.h"
+#include <deque>
+#include <mutex>
+#include <atomic>
+
+/* LEVEL-SYNCHRONOUS PARALLEL BREADTH FIRST SEARCH
+ * The search expands one depth layer at a time. A layer is split into
+ * shards by state hash. Every shard has its own lock, node storage and
+ * StateSet, so threads rarely wait on each other. Expanding layer d is one
+ * task per shard of layer d on a ThreadPool. The children are checked
+ * against layers d-1 and d (read only at that point) and inserted into
+ * layer d+1 under the lock of their shard.
+ *
+ * Checking only the neighbouring layers is enough, because every move can
+ * be undone by the opposite move as long as the master brick has not
+ * reached the exit. Solved states are never expanded for that reason.
+ * Older layers are only needed to trace the solution back.
+ * Exits the master can cover a part of (State::exitsAtOnce) break this:
+ * the cells it covered stay free, a state may come back layers later.
+ * On such boards the children are checked against all layers, which all
+ * stay in memory.
+ *
+ * The shard tasks check the budget with a Meter each, counting the nodes
+ * of the layers so far plus the ones added to the next layer yet. */
+
+namespace {
+
+	const unsigned int SHARDS = 64;
+
+	// reference to a node: shard and index in the shard of its layer
+	struct Ref {
+		unsigned int shard;
+		unsigned int index;
+	};
+
+	struct LNode {
+		State state;
+		Ref parent;
+		std::pair<int, Moves> trans;
+	};
+
+	struct Shard {
+		std::mutex mutex;
+		std::deque<LNode> nodes;
+		StateSet set;
+
+		// most layers are small. the sets grow on demand
+		Shard() : set(16) {};
+	};
+
+	struct Layer {
+		std::vector<Shard> shards;
+
+		Layer() : shards(SHARDS) {};
+
+		static unsigned int shardOf(const std::size_t hash) {
+			// high bits. the StateSet indexes with the low ones
+			return (unsigned int) (hash >> 58) % SHARDS;
+		}
+		// frees the duplicate detection tables, keeps the nodes
+		void dropSets() {
+			for (Shard& s : shards) s.set = StateSet(16);
+		}
+		std::size_t size() const {
+			std::size_t n = 0;
+			for (const Shard& s : shards) n += s.nodes.size();
+			return n;
+		}
+		// bytes of the nodes and the duplicate detection tables
+		std::size_t bytes() const {
+			std::size_t n = 0;
+			for (const Shard& s : shards) n += s.nodes.size() * sizeof(LNode) + s.set.bytes();
+			return n;
+		}
+		const bool contains(const State& state, const std::size_t hash) const {
+			return shards[shardOf(hash)].set.contains(state, hash);
+		}
+		// adds a state if it is new. returns the reference, or index == -1 for duplicates
+		Ref insert(const State& state, const std::size_t hash, const Ref parent, const std::pair<int, Moves>& trans) {
+			unsigned int k = shardOf(hash);
+			Shard& s = shards[k];
+			std::lock_guard<std::mutex> lock(s.mutex);
+			if (s.set.contains(state, hash)) {
+				return Ref{ k, (unsigned int) -1 };
+			}
+			s.nodes.push_back(LNode{ state, parent, trans });
+			LNode& node = s.nodes.back();
+			node.state.normalize();
+			s.set.insert(&node.state, hash);
+			return Ref{ k, (unsigned int) (s.nodes.size() - 1) };
+		}
+	};
+
+	/* runs the layer by layer search. "keepAll" keeps every layer for
+	 * tracing back the solution, otherwise only the last three layers live.
+	 * returns the solution depth (-1 = none, or out of "meter"s budget).
+	 * "goal" is the goal node ref. "meter" may be nullptr (no budget) */
+	int search(const State& root, const unsigned int threads, const bool keepAll, const bool stopAtGoal,
+		Budget::Meter* meter, std::vector<std::unique_ptr<Layer>>& layers, std::vector<std::size_t>& sizes,
+		Ref& goal) {
+		ThreadPool pool(threads);
+		layers.clear();
+		layers.push_back(std::unique_ptr<Layer>(new Layer()));
+		goal = layers[0]->insert(root, root.hash(), Ref{ 0, (unsigned int) -1 }, std::pair<int, Moves>(0, Moves::UP));
+		sizes.push_back(1);
+		if (root.isSolved()) {
+			return 0;
+		}
+		int depth = -1;
+		std::mutex goalMutex;
+		std::atomic<bool> found(false);
+		// nodes of all layers, bytes of the live ones (before the current layer)
+		std::size_t stored = 1, bytes = layers[0]->bytes();
+		// nodes added to the next layer
+		std::atomic<std::size_t> added(0);
+		// the layers a child may be known from (see above)
+		const bool reversible = root.exitsAtOnce();
+		std::vector<const Layer*> known;
+		for (int d = 0; layers.back()->size() > 0; d++) {
+			Layer* cur = layers.back().get();
+			Layer* next = new Layer();
+			known.clear();
+			for (std::size_t l = reversible && layers.size() > 1 ? layers.size() - 2 : 0; l < layers.size(); l++) {
+				known.push_back(layers[l].get());
+			}
+			added.store(0);
+			for (unsigned int k = 0; k < SHARDS; k++) {
+				pool.submit([&known, cur, next, k, meter, stored, bytes, &added, &goalMutex, &found, &goal]() {
+					std::unique_ptr<Budget::Meter> own(meter ? new Budget::Meter(*meter) : nullptr);
+					std::vector<Move> moves;
+					const std::deque<LNode>& nodes = cur->shards[k].nodes;
+					for (std::size_t i = 0; i < nodes.size(); i++) {
+						if (own) {
+							const std::size_t n = added.load(std::memory_order_relaxed);
+							if (own->exceeded(stored + n, [&]() { return bytes + n * sizeof(LNode); })) break;
+						}
+						const State& state = nodes[i].state;
+						// solved states are not expanded (see above)
+						if (state.isSolved()) continue;
+						std::size_t hash = state.hash();
+						state.getAllMoves(moves);
+						for (const Move& move : moves) {
+							std::size_t childHash = state.moveHash(hash, move);
+							State child = state.applyMoveCloning(move);
+							bool duplicate = false;
+							for (const Layer* layer : known) {
+								if ((duplicate = layer->contains(child, childHash))) break;
+							}
+							if (duplicate) continue;
+							Ref ref = next->insert(child, childHash, Ref{ k, (unsigned int) i },
+								std::pair<int, Moves>(move.piece.label, move.dir));
+							if (ref.index != (unsigned int) -1) added.fetch_add(1, std::memory_order_relaxed);
+							if (ref.index != (unsigned int) -1 && child.isSolved() && !found.load()) {
+								std::lock_guard<std::mutex> lock(goalMutex);
+								if (!found.load()) {
+									goal = ref;
+									found.store(true);
+								}
+							}
+						}
+					}
+				});
+			}
+			pool.wait();
+			layers.push_back(std::unique_ptr<Layer>(next));
+			// a layer cut short by the budget may miss the goal. its size does not count
+			if (meter && meter->stopped()) return -1;
+			sizes.push_back(next->size());
+			if (found.load() && depth < 0) {
+				depth = d + 1;
+				if (stopAtGoal) break;
+			}
+			// layer d-1 is not needed for duplicate detection anymore
+			if (reversible && layers.size() > 3) {
+				if (keepAll) layers[layers.size() - 4]->dropSets();
+				else layers[layers.size() - 4].reset();
+			}
+			stored += sizes.back();
+			bytes = 0;
+			for (const std::unique_ptr<Layer>& layer : layers) {
+				if (layer) bytes += layer->bytes();
+			}
+			if (meter && meter->exceededNow(stored, [&]() { return bytes; })) return -1;
+		}
+		// the last layer is always empty, unless the search stopped at the goal
+		if (sizes.back() == 0) sizes.pop_back();
+		return depth;
+	}
+}
+
+
+// PARALLEL BREADTH FIRST SEARCH
+void Search::pbfs(const State& m, const unsigned int threads, Budget::Meter& meter, Result& result) const {
+	std::vector<std::unique_ptr<Layer>> layers;
+	std::vector<std::size_t> sizes;
+	Ref goal;
+	int depth = search(m, threads, true, true, &meter, layers, sizes, goal);
+	for (std::size_t n : sizes) {
+		result.nodecount += (int) n;
+	}
+	// and the states of a layer the budget cut short
+	if (layers.size() > sizes.size()) result.nodecount += (int) layers.back()->size();
+	if (depth < 0) {
+		return;
+	}
+	// trace back the solution, layer by layer, and copy it into the Result
+	std::vector<const LNode*> path;
+	Ref ref = goal;
+	for (int d = depth; d >= 0; d--) {
+		const LNode& n = layers[d]->shards[ref.shard].nodes[ref.index];
+		path.push_back(&n);
+		ref = n.parent;
+	}
+	result.path = Path(path.back()->state);
+	for (std::size_t k = path.size() - 1; k > 0; k--) {
+		result.path.add(path[k]->state, path[k - 1]->trans.first, path[k - 1]->trans.second);
+	}
+	result.found = true;
+}
+
+
+Search::LayerCount Search::countLayers(const Matrix m, const bool stopAtGoal, const unsigned int threads,
+	const Budget& budget) const {
+	LayerCount count;
+	auto start = std::chrono::high_resolution_clock::now();
+	Budget::Meter meter(budget);
+	std::vector<std::unique_ptr<Layer>> layers;
+	Ref goal;
+	count.depth = search(State(m), threads, false, stopAtGoal, &meter, layers, count.layers, goal);
+	count.exceeded = meter.exceededBy();
+	auto end = std::chrono::high_resolution_clock::now();
+	count.time = (float(std::chrono::duration_cast
+		<std::chrono::milliseconds>(end - start).count())) / 1000;
+	return count;
+}
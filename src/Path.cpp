@@ -0,0 +1,24 @@
+#include "Path.h"
+
+
+void Path::add(const State& from, const int label, const Moves dir) {
+	moves.push_back(Move{ from.getPiece(label), dir });
+}
+
+
+State Path::goal() const {
+	State s(root);
+	for (const Move& move : moves) {
+		s.applyMove(move);
+		s.normalize();
+	}
+	return s;
+}
+
+
+std::ostream& operator<<(std::ostream& os, Path const& p) {
+	for (const Move& move : p.moves) {
+		os << "(" << (int) move.piece.label << "," << move.dir << ")" << std::endl;
+	}
+	return os;
+}
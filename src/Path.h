@@ -0,0 +1,37 @@
+#pragma once
+#include "State.h"
+#include <vector>
+#include <iostream>
+
+/* Solution of a search: the start state and the moves that lead from it
+ * to the goal. Each move carries the labels of the normalized State it is
+ * applied to (the root as given), like the search trees store them.
+ * Built once, when a search found its goal, by walking the parent links */
+class Path {
+
+public:
+	// empty path (no start state)
+	Path() {};
+	// path without moves that starts at "root"
+	explicit Path(const State& root) : root(root) {};
+
+
+	// member variables
+	State root;
+	std::vector<Move> moves;
+
+
+	/* appends the move of the piece "label" in direction "dir".
+	 * "from" is the State the move is applied to */
+	void add(const State& from, const int label, const Moves dir);
+	// # of moves
+	inline const std::size_t size() const {
+		return moves.size();
+	}
+	// replays all moves on the root and returns the final (normalized) State
+	State goal() const;
+
+
+	// outputs one "(label,direction)" line per move
+	friend std::ostream& operator<<(std::ostream& os, Path const& p);
+};
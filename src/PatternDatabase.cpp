@@ -0,0 +1,427 @@
+#include "PatternDatabase.h"
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <sstream>
+#include <iomanip>
+#include <mutex>
+#include <memory>
+
+
+namespace {
+	const char MAGIC[8] = { 'S', 'B', 'P', 'P', 'D', 'B', '4', 0 };
+
+	inline std::uint64_t mix(const std::uint64_t x) {
+		return DistanceTable<std::uint8_t>::mix(x);
+	}
+
+	// the codes stay below this, so that 1 can be added
+	const std::uint64_t MAX_CODE = 1ULL << 62;
+
+	// binomial coefficient C(n, k) for n <= State::MAX_CELLS (at most C(62, 31) < 2^59)
+	std::uint64_t choose(const int n, const int k) {
+		static const std::vector<std::vector<std::uint64_t>> table = [] {
+			std::vector<std::vector<std::uint64_t>> t(State::MAX_CELLS + 1);
+			for (int i = 0; i <= State::MAX_CELLS; i++) {
+				t[i].assign(i + 1, 1);
+				for (int j = 1; j < i; j++) t[i][j] = t[i - 1][j - 1] + t[i - 1][j];
+			}
+			return t;
+		}();
+		return k < 0 || k > n ? 0 : table[n][k];
+	}
+
+	/* the pieces of the abstraction of a part: the master (0) and the kept
+	 * pieces, grouped by shape. positions are cell indices of the top left corners */
+	struct Abstract {
+		int n;
+		std::vector<int> width, height;
+		// first piece of the group of each piece
+		std::vector<int> group;
+	};
+
+	// a group of pieces of one shape and how much it blocks the master
+	struct Group {
+		int width, height, count, blocking;
+	};
+}
+
+
+PatternDatabase::Layout PatternDatabase::boardOf(const State& s, const Piece* pieces, const int n) {
+	Layout l;
+	std::memset(&l, 0, sizeof(l));
+	l.width = s.width;
+	l.height = s.height;
+	int cell = 0;
+	for (int i = 0; i < s.height; i++) {
+		for (int j = 0; j < s.width; j++, cell++) {
+			int v = s.at(i, j);
+			if (v == 1) l.walls |= 1ULL << cell;
+			if (v < 0) l.exits |= 1ULL << cell;
+		}
+	}
+	for (int k = 0; k < n; k++) {
+		const Piece& p = pieces[k];
+		// sum: does not depend on the order of the pieces
+		l.pieces += mix((std::uint64_t) p.width << 8 | p.height | (std::uint64_t) (p.label == 2) << 16);
+		if (p.label == 2) {
+			l.masterWidth = p.width;
+			l.masterHeight = p.height;
+		}
+	}
+	return l;
+}
+
+
+PatternDatabase::Layout PatternDatabase::layoutOf(const State& s, const Piece* pieces, const int n) {
+	Layout l = boardOf(s, pieces, n);
+	const int cells = l.width * l.height;
+	// the cells between the master and the exits: the rectangle around both
+	int top = l.height, bottom = 0, left = l.width, right = 0;
+	for (int i = 0; i < cells; i++) {
+		if (!(l.exits >> i & 1)) continue;
+		top = std::min(top, i / l.width);
+		bottom = std::max(bottom, i / l.width + 1);
+		left = std::min(left, i % l.width);
+		right = std::max(right, i % l.width + 1);
+	}
+	for (int k = 0; k < n; k++) {
+		const Piece& p = pieces[k];
+		if (p.label != 2) continue;
+		top = std::min(top, (int) p.row);
+		bottom = std::max(bottom, p.row + p.height);
+		left = std::min(left, (int) p.col);
+		right = std::max(right, p.col + p.width);
+	}
+	const std::uint64_t between = Kernels::rectangle(l.width, top, bottom, left, right);
+	// the groups of equal shape and how many of their cells are in the way
+	std::vector<Group> groups;
+	for (int k = 0; k < n; k++) {
+		const Piece& p = pieces[k];
+		if (p.label == 2) continue;
+		auto it = std::find_if(groups.begin(), groups.end(), [&p](const Group& g) {
+			return g.width == p.width && g.height == p.height;
+		});
+		if (it == groups.end()) {
+			groups.push_back(Group{ p.width, p.height, 0, 0 });
+			it = groups.end() - 1;
+		}
+		it->count++;
+		it->blocking += Kernels::count(Kernels::rectangle(l.width, p.row, p.row + p.height, p.col, p.col + p.width) & between);
+	}
+	// most blocking first, then the largest area
+	std::sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) {
+		if (a.blocking != b.blocking) return a.blocking > b.blocking;
+		int areaA = a.count * a.width * a.height, areaB = b.count * b.width * b.height;
+		if (areaA != areaB) return areaA > areaB;
+		return a.width != b.width ? a.width > b.width : a.height > b.height;
+	});
+	/* fill the parts in that order: a part takes groups while it keeps at
+	 * most half of the pieces and its codes fit, but at least one. a group
+	 * with all pieces of the board (or too many positions) is left out */
+	const int half = (n - 1) / 2;
+	int part = 0, kept = 0;
+	std::uint64_t radix = (std::uint64_t) cells;
+	for (const Group& g : groups) {
+		if (l.shapeCount == MAX_SHAPES) break;
+		std::uint64_t sets = choose(cells, g.count);
+		if (g.count == n - 1 || sets >= MAX_CODE / cells) continue;
+		if (kept > 0 && (kept + g.count > half || sets >= MAX_CODE / radix)) {
+			part++;
+			kept = 0;
+			radix = (std::uint64_t) cells;
+		}
+		l.shapes[l.shapeCount++] = Shape{ (std::uint8_t) g.width, (std::uint8_t) g.height,
+			(std::uint8_t) g.count, (std::uint8_t) part };
+		kept += g.count;
+		radix *= sets;
+	}
+	l.partCount = (std::uint16_t) (part + 1);
+	return l;
+}
+
+
+const bool PatternDatabase::sameBoard(const Layout& a, const Layout& b) {
+	return a.width == b.width && a.height == b.height && a.walls == b.walls
+		&& a.exits == b.exits && a.pieces == b.pieces;
+}
+
+
+std::uint64_t PatternDatabase::code(const int part, const Piece* pieces, const int n) const {
+	// the master, then the rank of the positions of each group. getPieces lists the pieces by position
+	const int cells = layout.width * layout.height;
+	std::uint64_t c = 0;
+	for (int i = 0; i < n; i++) {
+		if (pieces[i].label == 2) c = (std::uint64_t) (pieces[i].row * layout.width + pieces[i].col);
+	}
+	for (unsigned int g = 0; g < layout.shapeCount; g++) {
+		const Shape& shape = layout.shapes[g];
+		if (shape.part != part) continue;
+		std::uint64_t rank = 0;
+		int k = 0;
+		for (int i = 0; i < n; i++) {
+			const Piece& p = pieces[i];
+			if (p.label == 2 || p.width != shape.width || p.height != shape.height) continue;
+			rank += choose(p.row * layout.width + p.col, ++k);
+		}
+		c = c * choose(cells, shape.count) + rank;
+	}
+	return c + 1;
+}
+
+
+PatternDatabase* PatternDatabase::build(const State& start, Budget::Meter* meter) {
+	// the abstract goal covers all exits at once. with exits used up one by one it overestimates
+	if (!start.exitsAtOnce()) return nullptr;
+	std::unique_ptr<PatternDatabase> db(new PatternDatabase());
+	Piece pieces[State::MAX_CELLS];
+	int n = start.getPieces(pieces);
+	db->layout = layoutOf(start, pieces, n);
+	for (int part = 0; part < db->layout.partCount; part++) {
+		if (!db->fill(part, meter)) return nullptr;
+	}
+	return db.release();
+}
+
+
+bool PatternDatabase::fill(const int part, Budget::Meter* meter) {
+	const Layout& l = layout;
+	const int width = l.width, height = l.height, cells = width * height;
+	// the pieces of the abstraction, and the first piece and size of each group
+	Abstract a;
+	a.n = 1;
+	a.width.push_back(l.masterWidth);
+	a.height.push_back(l.masterHeight);
+	a.group.push_back(0);
+	std::vector<std::pair<int, int>> groups;
+	for (unsigned int g = 0; g < l.shapeCount; g++) {
+		if (l.shapes[g].part != part) continue;
+		groups.push_back(std::pair<int, int>(a.n, l.shapes[g].count));
+		for (int k = 0; k < l.shapes[g].count; k++, a.n++) {
+			a.width.push_back(l.shapes[g].width);
+			a.height.push_back(l.shapes[g].height);
+			a.group.push_back(groups.back().first);
+		}
+	}
+	const std::uint64_t all = Kernels::rectangle(width, 0, height, 0, width);
+	// cells the master may cover (free and exits), and the other pieces (free)
+	const std::uint64_t masterCells = all & ~l.walls, pieceCells = all & ~l.walls & ~l.exits;
+	auto covered = [&](const int i, const int pos) {
+		return Kernels::rectangle(width, pos / width, pos / width + a.height[i], pos % width, pos % width + a.width[i]);
+	};
+	// a piece fits at a position if it stays on the board, on the cells it may cover
+	auto fits = [&](const int i, const int pos) {
+		int row = pos / width, col = pos % width;
+		if (row + a.height[i] > height || col + a.width[i] > width) return false;
+		return (covered(i, pos) & ~(i == 0 ? masterCells : pieceCells)) == 0;
+	};
+	// same as code(), the positions of each group in increasing order
+	auto pack = [&](const int* pos) {
+		std::uint64_t c = (std::uint64_t) pos[0];
+		for (const std::pair<int, int>& g : groups) {
+			std::uint64_t rank = 0;
+			for (int k = 0; k < g.second; k++) rank += choose(pos[g.first + k], k + 1);
+			c = c * choose(cells, g.second) + rank;
+		}
+		return c + 1;
+	};
+	std::unordered_map<std::uint64_t, std::uint8_t> dist;
+	// the positions of the abstract states, a.n per state, in breadth first order
+	std::vector<std::uint8_t> queue;
+	std::vector<int> pos(a.n), next(a.n);
+	auto enqueue = [&](const int* p, const std::uint8_t d) {
+		if (!dist.emplace(pack(p), d).second) return;
+		for (int i = 0; i < a.n; i++) queue.push_back((std::uint8_t) p[i]);
+	};
+	// 1. all abstract goals: the master covering the exits, the kept pieces anywhere else
+	std::function<void(int, std::uint64_t)> place = [&](const int i, const std::uint64_t used) {
+		if (i == a.n) {
+			enqueue(pos.data(), 0);
+			return;
+		}
+		// pieces of a group in increasing positions
+		int from = a.group[i] == i ? 0 : pos[i - 1] + 1;
+		for (int p = from; p < cells; p++) {
+			if (!fits(i, p) || (covered(i, p) & used)) continue;
+			if (i == 0 && (covered(i, p) & l.exits) != l.exits) continue;
+			pos[i] = p;
+			place(i + 1, used | covered(i, p));
+		}
+	};
+	place(0, 0);
+	// 2. breadth first search from all goals at once
+	const int offsets[4] = { -width, width, -1, 1 };
+	for (std::size_t q = 0; q < queue.size(); q += a.n) {
+		// the abstract states count towards the memory of the search, not its nodes
+		if (meter && meter->exceeded(0, [&]() { return queue.size() + dist.size() * 2 * sizeof(std::uint64_t); })) {
+			return false;
+		}
+		std::uint64_t used = 0;
+		for (int i = 0; i < a.n; i++) {
+			pos[i] = queue[q + i];
+			used |= covered(i, pos[i]);
+		}
+		std::uint8_t d = dist[pack(pos.data())];
+		for (int i = 0; i < a.n; i++) {
+			std::uint64_t others = used & ~covered(i, pos[i]);
+			for (int dir = 0; dir < 4; dir++) {
+				int p = pos[i] + offsets[dir];
+				// no wrapping around the rows
+				if (p < 0 || (dir >= 2 && p / width != pos[i] / width)) continue;
+				if (!fits(i, p) || (covered(i, p) & others)) continue;
+				next = pos;
+				next[i] = p;
+				// keep the group sorted
+				for (int k = i; k > a.group[i] && next[k] < next[k - 1]; k--) std::swap(next[k], next[k - 1]);
+				for (int k = i; k + 1 < a.n && a.group[k + 1] == a.group[i] && next[k] > next[k + 1]; k++) {
+					std::swap(next[k], next[k + 1]);
+				}
+				enqueue(next.data(), (std::uint8_t) std::min(d + 1, 255));
+			}
+		}
+	}
+	// 3. fill the table
+	tables[part].reserve(dist.size(), 0);
+	for (const auto& e : dist) {
+		tables[part].insert(e.first, e.second);
+	}
+	return true;
+}
+
+
+PatternDatabase* PatternDatabase::load(const std::string& path) {
+	std::unique_ptr<PatternDatabase> db(new PatternDatabase());
+	MappedFile& file = db->file;
+	Header header;
+	if (!file.open(path) || file.size() < sizeof(Header) || std::memcmp(file.data(), MAGIC, sizeof(MAGIC)) != 0) {
+		return nullptr;
+	}
+	std::memcpy(&header, file.data(), sizeof(Header));
+	const Layout& l = header.layout;
+	if (l.shapeCount > MAX_SHAPES || l.partCount == 0 || l.partCount > MAX_SHAPES) {
+		return nullptr;
+	}
+	for (unsigned int g = 0; g < l.shapeCount; g++) {
+		if (l.shapes[g].part >= l.partCount) return nullptr;
+	}
+	// the tables of the parts follow the header
+	std::size_t offset = sizeof(Header);
+	for (int part = 0; part < l.partCount; part++) {
+		std::size_t bytes = db->tables[part].map(file.data() + offset, file.size() - offset);
+		if (!bytes) return nullptr;
+		offset += bytes;
+	}
+	if (offset != file.size()) {
+		return nullptr;
+	}
+	db->layout = l;
+	return db.release();
+}
+
+
+bool PatternDatabase::save(const std::string& path) const {
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.layout = layout;
+	const DistanceTable<std::uint8_t>* parts[MAX_SHAPES];
+	for (int part = 0; part < layout.partCount; part++) parts[part] = &tables[part];
+	return DistanceTable<std::uint8_t>::save(path, &header, sizeof(Header), parts, layout.partCount);
+}
+
+
+const bool PatternDatabase::matches(const State& s) const {
+	Piece pieces[State::MAX_CELLS];
+	int n = s.getPieces(pieces);
+	return sameBoard(layout, boardOf(s, pieces, n));
+}
+
+
+const int PatternDatabase::distance(const State& s) const {
+	if (s.isSolved()) return 0;
+	Piece pieces[State::MAX_CELLS];
+	int n = s.getPieces(pieces);
+	// the parts are disjoint abstractions, each one a lower bound
+	int d = 0;
+	for (int part = 0; part < layout.partCount; part++) {
+		d = std::max(d, (int) tables[part].find(code(part, pieces, n), 0));
+	}
+	return d;
+}
+
+
+const std::size_t PatternDatabase::size() const {
+	std::size_t n = 0;
+	for (int part = 0; part < layout.partCount; part++) n += tables[part].size();
+	return n;
+}
+
+
+const int PatternDatabase::parts() const {
+	return layout.partCount;
+}
+
+
+const int PatternDatabase::kept() const {
+	int n = 0;
+	for (unsigned int g = 0; g < layout.shapeCount; g++) n += layout.shapes[g].count;
+	return n;
+}
+
+
+std::uint64_t PatternDatabase::boardId(const Layout& l) {
+	return mix(l.walls ^ mix(l.exits ^ mix(l.pieces ^ ((std::uint64_t) l.width << 8 | l.height))));
+}
+
+
+std::shared_ptr<const PatternDatabase> PatternDatabase::Store::get(const State& s, Budget::Meter* meter) {
+	Piece pieces[State::MAX_CELLS];
+	int n = s.getPieces(pieces);
+	Layout l = boardOf(s, pieces, n);
+	if (!s.exitsAtOnce()) return nullptr;
+	std::shared_ptr<Entry> entry;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (const std::shared_ptr<Entry>& e : entries) {
+			if (sameBoard(e->board, l)) entry = e;
+		}
+		if (!entry) {
+			if (entries.size() >= capacity) {
+				entries.erase(std::min_element(entries.begin(), entries.end(),
+					[](const std::shared_ptr<Entry>& a, const std::shared_ptr<Entry>& b) { return a->used < b->used; }));
+			}
+			entry = std::make_shared<Entry>();
+			entry->board = l;
+			entries.push_back(entry);
+		}
+		entry->used = ++clock;
+	}
+	// once per layout: the first caller builds, the others of that layout wait
+	std::lock_guard<std::mutex> once(entry->building);
+	if (entry->db) return entry->db;
+	std::string path;
+	if (!directory.empty()) {
+		std::ostringstream os;
+		os << directory << "/" << std::hex << std::setfill('0') << std::setw(16) << boardId(l) << ".pdb";
+		path = os.str();
+	}
+	std::unique_ptr<PatternDatabase> db;
+	if (!path.empty()) {
+		db.reset(load(path));
+	}
+	if (!db || !sameBoard(db->layout, l)) {
+		db.reset(build(s, meter));
+		// stopped by the budget: the next caller tries again
+		if (!db) return nullptr;
+		// one that cannot be saved is only kept in memory
+		if (!path.empty()) db->save(path);
+	}
+	entry->db = std::move(db);
+	return entry->db;
+}
+
+
+std::size_t PatternDatabase::Store::size() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return entries.size();
+}
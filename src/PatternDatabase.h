@@ -0,0 +1,162 @@
+#pragma once
+#include "State.h"
+#include "DistanceTable.h"
+#include "MappedFile.h"
+#include "Budget.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+/* Pattern database heuristic.
+ * An abstraction keeps the master brick and some groups of pieces (a group:
+ * all pieces of one shape, they are interchangeable) and treats the cells of
+ * all other pieces as free. The database of a board layout consists of
+ * several disjoint abstractions, its parts. The groups are ranked by how
+ * much they block the master: # of their cells between the master and the
+ * exits at the start, then their area. A part takes the next groups in that
+ * order while it keeps at most half of the pieces (at least one group, never
+ * all of them). The distance of a State is the maximum over the parts.
+ *
+ * Building runs a breadth first search backwards from all abstract goals of
+ * a part at once: every placement of the master covering the exits, with the
+ * kept pieces anywhere else. Moves of the abstraction are reversible, so this
+ * yields the exact abstract distance to the goal of every abstract state that
+ * can reach one. Every move of the puzzle is a move of the abstraction or
+ * none, thus the distances (and their maximum) are an admissible and
+ * consistent heuristic.
+ *
+ * An abstract state is the position of the master and the set of positions
+ * of each kept group, numbered in a mixed radix code (the rank of the set
+ * among all sets of that many cells). Each part maps codes to distances
+ * (1 byte, see DistanceTable.h). The database can be saved and loaded
+ * (memory mapped, no copy) from disk. One database serves every State of
+ * the same layout (dimensions, walls, exits, piece shapes). Search::run gets
+ * the one of its board from the Store of the caller (or builds its own),
+ * the heuristic gets it from the Search::Heuristic::Context */
+class PatternDatabase {
+
+public:
+	// max # of kept groups, over all parts
+	static const int MAX_SHAPES = 8;
+
+
+	/* builds the database of the layout of "start" (unsolved, with exits).
+	 * the caller owns the object. "meter" (optional) limits the time and
+	 * memory of the build: nullptr once it stops it. nullptr as well if the
+	 * master can cover a part of the exits (State::exitsAtOnce): the
+	 * abstract goal, all exits covered at once, would overestimate */
+	static PatternDatabase* build(const State& start, Budget::Meter* meter = nullptr);
+	// empty destructor (the mapping, if any, is released by the tables)
+	~PatternDatabase() {};
+	PatternDatabase(const PatternDatabase&) = delete;
+	PatternDatabase& operator= (const PatternDatabase&) = delete;
+
+
+	/* maps a database file. returns nullptr if it cannot be read or is
+	 * not a valid database. the caller owns the object */
+	static PatternDatabase* load(const std::string& path);
+	// writes the database to a file. false on error
+	bool save(const std::string& path) const;
+	// checks if a State has the layout of this database
+	const bool matches(const State&) const;
+	/* lower bound of the # of moves needed to solve a State of this layout.
+	 * parts whose abstract state cannot reach a goal count 0 */
+	const int distance(const State&) const;
+	// # of abstract states in all tables
+	const std::size_t size() const;
+	// # of parts
+	const int parts() const;
+	// # of kept pieces besides the master, over all parts
+	const int kept() const;
+
+	/* the databases of the layouts solved so far, shared by the searches
+	 * that are given the Store (Search, SolveOptions). owned by the caller.
+	 * Each layout is built once, by the first search that needs it, outside
+	 * the lock of the Store: the others wait for that layout only. A build
+	 * stopped by the budget of its search is not kept, the next one retries.
+	 * At most "capacity" layouts are kept, the least recently used is
+	 * dropped (searches that still use it keep it alive). With a "directory"
+	 * a database is loaded from there before it is built, and saved there
+	 * after (if it can, failures are not reported). "" = memory only */
+	class Store;
+
+
+private:
+	/* a kept group: shape, # of pieces of that shape (master excluded)
+	 * and the part that keeps it */
+	struct Shape {
+		std::uint8_t width, height, count, part;
+	};
+	/* layout of the board. everything a State needs to share with the
+	 * database. stored as is in the file header */
+	struct Layout {
+		std::uint8_t width, height;
+		std::uint8_t masterWidth, masterHeight;
+		std::uint16_t shapeCount, partCount;
+		// bit i = cell i is a wall (1) / an exit (-1)
+		std::uint64_t walls, exits;
+		// hash of all piece shapes of the board (order independent)
+		std::uint64_t pieces;
+		Shape shapes[MAX_SHAPES];
+	};
+	// file header, followed by the table of each part
+	struct Header {
+		char magic[8];
+		Layout layout;
+	};
+	static_assert(sizeof(Header) % 8 == 0, "the tables must start 8 byte aligned");
+
+	Layout layout;
+	DistanceTable<std::uint8_t> tables[MAX_SHAPES];
+	// the mapping of a loaded database
+	MappedFile file;
+
+	PatternDatabase() {};
+
+	/* board of a State with "n" pieces (from State::getPieces): all of the
+	 * Layout but the kept groups (which follow from the pieces) */
+	static Layout boardOf(const State&, const Piece*, const int n);
+	// the whole layout: the board, the kept groups and the parts
+	static Layout layoutOf(const State&, const Piece*, const int n);
+	static const bool sameBoard(const Layout&, const Layout&);
+	// 64 bit id of a board (names the file in the database directory)
+	static std::uint64_t boardId(const Layout&);
+	// abstract code of a State of this layout in a part. never 0
+	std::uint64_t code(const int part, const Piece*, const int n) const;
+	// builds the table of a part. false if "meter" stopped it
+	bool fill(const int part, Budget::Meter* meter);
+};
+
+
+class PatternDatabase::Store {
+public:
+	explicit Store(const std::size_t capacity = 64, const std::string& directory = "")
+		: capacity(capacity ? capacity : 1), directory(directory), clock(0) {};
+	~Store() {};
+	Store(const Store&) = delete;
+	Store& operator= (const Store&) = delete;
+
+	/* the database of the layout of a State. nullptr if "meter"
+	 * (optional) stopped its build or there is none (see build) */
+	std::shared_ptr<const PatternDatabase> get(const State&, Budget::Meter* meter = nullptr);
+	// # of layouts kept
+	std::size_t size();
+
+private:
+	struct Entry {
+		Layout board;
+		// held while the database is loaded or built. guards "db"
+		std::mutex building;
+		std::shared_ptr<const PatternDatabase> db;
+		// last use, for dropping the least recently used
+		std::uint64_t used;
+	};
+	const std::size_t capacity;
+	const std::string directory;
+	// guards entries and clock
+	std::mutex mutex;
+	std::vector<std::shared_ptr<Entry>> entries;
+	std::uint64_t clock;
+};
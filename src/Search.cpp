@@ -1,4 +1,10 @@
 #include "Search.h"
+#include "StateSet.h"
+#include "StateMap.h"
+#include "TranspositionTable.h"
+#include "OpenList.h"
+#include "Board.h"
+#include <climits>
 #include <sstream>
 #include <queue>
 #include <stack>
@@ -6,311 +12,705 @@
 #include <random>
 
 
-void Search::run(const Matrix m, const Search::Algorithm a, const int heuristic(Matrix&)) {
-	reset();
+Search::Result Search::run(const Matrix m, const Search::Algorithm a, const Heuristic::Function heuristic,
+	const unsigned int threads, const Budget& budget, const Improvement& improved) const {
+	// pack the Matrix. the search works on a copy, not the original Matrix object
+	return run(State(m), a, heuristic, threads, budget, improved);
+}
+
+
+Search::Result Search::run(const State& m, const Search::Algorithm a, const Heuristic::Function heuristic,
+	const unsigned int threads, const Budget& budget, const Improvement& improved) const {
+	Result result;
 	// start time measure..
 	auto start = std::chrono::high_resolution_clock::now();
-	// create a clone to not operate on the original Matrix object
-	Matrix m_clone(m);
-	// select algorithm
-	switch (a) {
-		case RAND: randomWalk(m_clone); break;
-		case BFS: bfs(m_clone); break;
-		case DFS: dfs(m_clone); break;
-		case IDDFS: iddfs(m_clone); break;
-		case ASTAR: astar(m_clone, heuristic); break;
-		default: std::cout <<
-		"Error. Invalid or no algorithm provided" << std::endl;
+	// the clock of the budget starts with the search
+	Budget::Meter meter(budget);
+	State m_clone(m);
+	// states along earlier optimal solutions need no search
+	if (cache && a != RAND && cache->find(m_clone, result.path)) {
+		result.found = true;
+		result.bound = 1;
+	}
+	else {
+		/* what the heuristic needs besides the State (Heuristic::pattern: the
+		 * database). built under the budget, a build it stopped ends the run */
+		std::shared_ptr<const PatternDatabase> database;
+		if (heuristic == Heuristic::pattern && !m_clone.isSolved() && m_clone.exitsAtOnce()
+			&& (a == ASTAR || a == ASTAR_BUCKETS || a == HDASTAR || a == IDASTAR || a == ARASTAR)) {
+			database = patterns ? patterns->get(m_clone, &meter)
+				: std::shared_ptr<const PatternDatabase>(PatternDatabase::build(m_clone, &meter));
+		}
+		const Heuristic::Context context(database.get());
+		// select algorithm
+		if (!meter.stopped()) {
+			switch (a) {
+				case RAND: randomWalk(m_clone, result); break;
+				case BFS: case DFS: case IDDFS: case ASTAR: case ASTAR_BUCKETS: case IDASTAR: case ARASTAR:
+					sequential(m_clone, a, heuristic, context, meter, improved, result); break;
+				case HDASTAR: hdastar(m_clone, heuristic, context, threads, meter, result); break;
+				case PBFS: pbfs(m_clone, threads, meter, result); break;
+				// invalid or no algorithm: no solution
+				default: break;
+			}
+		}
+		result.exceeded = meter.exceededBy();
+		if (result.found && optimal(a, heuristic)) {
+			result.bound = 1;
+		}
+		// ARA* solutions count once the search got down to weight 1
+		if (cache && result.found && result.bound == 1) {
+			cache->store(result.path);
+		}
 	}
 
 	// ..end time measure
 	auto end = std::chrono::high_resolution_clock::now();
-	time = (float(std::chrono::duration_cast
+	result.time = (float(std::chrono::duration_cast
 		<std::chrono::milliseconds>(end - start).count())) / 1000;
+	result.stats.totalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	return result;
 }
 
 
-void Search::printResults(const bool printSteps) {
-	std::vector<std::string> list;
-	std::ostringstream os_solved;
-	if (!&goalNode->m) {
-		std::cout << "Error. run() method was not called. Nothing to print" << std::endl;
-		return;
+void Search::sequential(const State& m, const Search::Algorithm a, const Heuristic::Function heuristic,
+	const Heuristic::Context& context, Budget::Meter& meter, const Improvement& improved, Result& result) const {
+	// the board sizes of the levels. everything else runs on the generic engine
+	if (fixedSizes) {
+		if (FixedBoard<5, 4>::fits(m))
+			return sequential<FixedBoard<5, 4>>(m, a, heuristic, context, meter, improved, result);
+		if (FixedBoard<6, 6>::fits(m))
+			return sequential<FixedBoard<6, 6>>(m, a, heuristic, context, meter, improved, result);
+		if (FixedBoard<6, 7>::fits(m))
+			return sequential<FixedBoard<6, 7>>(m, a, heuristic, context, meter, improved, result);
 	}
-	os_solved << goalNode->m;
-	int length = goalNode->getParentCount();
-	while (goalNode) {
-		std::ostringstream os;
-		os << "(" << goalNode->trans.first;
-		os << "," << goalNode->trans.second << ")" << std::endl;
-		list.push_back(os.str());
-		goalNode = goalNode->parent;
+	sequential<AnyBoard>(m, a, heuristic, context, meter, improved, result);
+}
+
+
+template <typename Board>
+void Search::sequential(const State& m, const Search::Algorithm a, const Heuristic::Function heuristic,
+	const Heuristic::Context& context, Budget::Meter& meter, const Improvement& improved, Result& result) const {
+	switch (a) {
+		case BFS: bfs<Board>(m, meter, result); break;
+		case DFS: dfs<Board>(m, meter, result); break;
+		case IDDFS: iddfs<Board>(m, meter, result); break;
+		case ASTAR: astar<HeapOpenList, Board>(m, heuristic, context, meter, result); break;
+		case ASTAR_BUCKETS: astar<BucketOpenList, Board>(m, heuristic, context, meter, result); break;
+		case IDASTAR: idastar<Board>(m, heuristic, context, meter, result); break;
+		case ARASTAR: arastar<Board>(m, heuristic, context, meter, improved, result); break;
+		default: break;
 	}
-	// remove root nodes information about its parent which is NULL!
-	list.pop_back();
-	// reverse list to start from root node
-	std::reverse(list.begin(), list.end());
-	// append solved puzzle Matrix
-	list.push_back(os_solved.str());
+}
+
+
+const bool Search::optimal(const Search::Algorithm a, const Heuristic::Function heuristic) {
+	switch (a) {
+		// IDDFS: the depth limit grows by one, the first solution is a shortest one
+		case BFS: case PBFS: case IDDFS: return true;
+		// with an admissible heuristic (blocking overestimates, see there)
+		case ASTAR: case ASTAR_BUCKETS: case HDASTAR: case IDASTAR:
+			return admissible(heuristic);
+		// ARA* reports its bound itself (Result::bound)
+		default: return false;
+	}
+}
 
+
+const bool Search::admissible(const Heuristic::Function heuristic) {
+	return heuristic == Heuristic::manhatten || heuristic == Heuristic::pattern;
+}
+
+
+void Search::printResults(const Result& result, const bool printSteps, std::ostream& os) {
+	if (result.exceeded != Budget::NONE && !result.solved()) {
+		os << "Budget exceeded (" << Budget::name(result.exceeded) << ") after "
+			<< result.nodecount << " nodes, " << result.time << "s. No solution" << std::endl;
+		return;
+	}
+	if (!result.solved()) {
+		os << "Error. No solution found (or run() was not called). Nothing to print" << std::endl;
+		return;
+	}
 	// print
 	if (printSteps) {
-		for (auto const& s : list) {
-			std::cout << s;
-		}
-		std::cout << std::endl << goalNode->m;
+		os << result.path;
+		// solved puzzle
+		os << std::endl << result.path.goal();
 	}
 	// stats
-	std::cout << "#nodes: " << nodecount << "  time: " << time << "s"
-		<< "  length: " << length // includes goal node and root node!
+	os << "#nodes: " << result.nodecount << "  time: " << result.time << "s"
+		<< "  length: " << result.length()
 		<< std::endl;
-	// clean up
-	delete goalNode;
-	reset();
-}
-
-
-void Search::reset() {
-	nodecount = 0;
-	time = 0;
-	explored.clear();
+	if (Stats::enabled) {
+		result.stats.writeJSON(os);
+		os << std::endl;
+	}
 }
 
 
 // RANDOM WALK
-void Search::randomWalk(Matrix& m, const unsigned int n) {
-	std::cout << m << std::endl;
-	for (unsigned int i = 0; i < n; i++) {
+void Search::randomWalk(const State& start, Result& result, const unsigned int n) const {
+	std::random_device rd; // obtain a random number from hardware
+	std::mt19937 eng(rd()); // seed the generator
+	State m(start);
+	m.normalize();
+	result.path = Path(m);
+	std::vector<Move> moves;
+	for (unsigned int i = 0; i < n && !m.isSolved(); i++) {
 		// 1. getAllMoves
-		std::unordered_map<unsigned int, std::vector<Moves>> allMoves = m.getAllMoves();
+		m.getAllMoves(moves);
+		if (moves.empty()) break;
 
 		// 2. select one move at random
-		// 2.1 rand seed
-		std::random_device rd; // obtain a random number from hardware
-		std::mt19937 eng(rd()); // seed the generator
-								// 2.2 select a piece at random
-		std::vector<int> pieceList;
-		std::unordered_map<unsigned int, std::vector<Moves>>::iterator it;
-		for (it = allMoves.begin(); it != allMoves.end(); ++it) {
-			pieceList.push_back(it->first);
-		}
-		std::uniform_int_distribution<> distr(0, pieceList.size() - 1); // range both inclusives
-		unsigned int rand_piece = pieceList.at(distr(eng));
-		// 2.3 select a move at random
-		std::vector<Moves> pieceMoves = allMoves[rand_piece];
-		std::uniform_int_distribution<> distr2(0, pieceMoves.size() - 1); // range both inclusives
-		Moves rand_move = pieceMoves.at(distr2(eng));
+		std::uniform_int_distribution<> distr(0, moves.size() - 1); // range both inclusives
+		Move rand_move = moves.at(distr(eng));
 
-		// 3. Execute move (applyMove)
-		m.applyMove(rand_piece, rand_move);
+		// 3. Execute move (applyMove). the moves carry the labels of the normalized board
+		m.applyMove(rand_move);
+		result.path.moves.push_back(rand_move);
 
 		// 4. normalize resulting matrix
 		m.normalize();
-
-		std::cout << "(" << rand_piece << "," << rand_move << ")"
-			<< std::endl << std::endl << m << std::endl;
-
-		// 5. if goal stop, else goto 1.
-		if (m.isSolved()) return;
 	}
+	// 5. stop at the goal
+	result.nodecount = (int) result.path.size();
+	result.found = m.isSolved();
 }
 
 
 // BREADTH FIRST SEARCH
-void Search::bfs(Matrix& m) {
-	std::queue<std::shared_ptr<Node>> q;
-	std::vector<std::shared_ptr<Node>> visited;
+template <typename Board>
+void Search::bfs(const State& m, Budget::Meter& meter, Result& result) const {
+	// owns the nodes. the queue holds their indices
+	NodeArena<Node> nodes;
+	std::queue<unsigned int> q;
+	// the hash set answers "already visited?" in O(1)
+	StateSet visited;
+	// reused for every expansion
+	std::vector<Move> moves;
 	// root node
-	std::shared_ptr<Node> root(new Node(Matrix(m)));
-	visited.push_back(root);
+	unsigned int root = nodes.add(Node(m));
+	visited.insert(&nodes[root].state);
 	q.push(root);
 	// start search
 	while (!q.empty()) {
-		std::shared_ptr<Node> current = q.front();
-		q.pop();
+		if (meter.exceeded(visited.size(), [&]() {
+			return nodes.bytes() + visited.bytes() + q.size() * sizeof(unsigned int);
+		})) {
+			result.nodecount = visited.size();
+			break;
+		}
+		STATS(result.stats.open(q.size()));
+		unsigned int current = q.front();
+		STATS_TIMED(result.stats, QUEUE, q.pop());
+		const State& state = nodes[current].state; // arena nodes never move
 		// goal reached?
-		if (current->m.isSolved()) {
-			nodecount = visited.size();
-			goalNode = new Node(*current);
+		if (state.isSolved()) {
+			result.nodecount = visited.size();
+			extract(nodes, current, result);
 			break;
 		}
 		// get all valid moves and add children nodes to queue if new
-		std::unordered_map<unsigned int, std::vector<Moves>> allMoves = current->m.getAllMoves();
-		std::unordered_map<unsigned int, std::vector<Moves>>::iterator it;
-		for (it = allMoves.begin(); it != allMoves.end(); ++it) {
-			for (unsigned int j = 0; j < it->second.size(); j++) {
-				// create a child Matrix
-				Matrix m_child = current->m.applyMoveCloning(it->first, it->second[j]);
-				m_child.normalize();
-				std::pair<int, Moves> transition(it->first, it->second[j]);
-				// create a child Node
-				std::shared_ptr<Node> child(new Node(m_child, current.get(), transition)); // can't be unique_ptr, because its added to two containers
-				// if child was not already visited, add it to the visited list and the queue
-				if (!std::any_of(visited.begin(), visited.end(), 
-					[&child](const std::shared_ptr<Node>& n) { return child->m == n->m; })) {
-					visited.push_back(child);
-					q.push(child);
-				}
+		std::size_t hash = STATS_TIMED(result.stats, HASH, Board::hash(state));
+		STATS_TIMED(result.stats, MOVEGEN, Board::getAllMoves(state, moves));
+		STATS(result.stats.expand(moves.size()));
+		for (const Move& move : moves) {
+			// create a child State. duplicates are rejected before normalizing it
+			std::size_t childHash = STATS_TIMED(result.stats, HASH, Board::moveHash(state, hash, move));
+			State m_child = Board::applyMoveCloning(state, move);
+			if (STATS_TIMED(result.stats, HASH, visited.contains(m_child, childHash))) {
+				STATS(result.stats.duplicates++);
+				continue;
 			}
+			STATS_TIMED(result.stats, NORMALIZE, Board::normalize(m_child));
+			std::pair<int, Moves> transition(move.piece.label, move.dir);
+			// create a child Node. child was not visited yet: add it to the visited list and the queue
+			unsigned int child = nodes.add(Node(m_child, current, transition));
+			STATS_TIMED(result.stats, HASH, visited.insert(&nodes[child].state, childHash));
+			STATS_TIMED(result.stats, QUEUE, q.push(child));
 		}
 	}
+	STATS(result.stats.closed(visited.size()));
 }
 
 
 // DEPTH FIRST SEARCH
-void Search::dfs(Matrix& m) {
-	std::stack<std::shared_ptr<Node>> s;
-	std::vector<std::shared_ptr<Node>> visited;
-	// root node
-	std::shared_ptr<Node> root(new Node(Matrix(m)));
-	visited.push_back(root);
-	s.push(root);
+template <typename Board>
+void Search::dfs(const State& m, Budget::Meter& meter, Result& result) const {
+	/* the only board of the search. moves are applied and undone in place.
+	 * the children of a state are tried last move first, like popping them
+	 * from a stack, so the search visits the states in the same order */
+	State board(m);
+	StateSet visited;
+	// copies of the visited states (the set only holds pointers)
+	std::deque<State> seen;
+	// one move list per depth, reused. deque: growing keeps references valid
+	std::deque<std::vector<Move>> moves;
+	// per depth: # of moves still to try, hash of the board, exits the applied move covered
+	std::vector<std::size_t> next;
+	std::vector<std::size_t> hashes;
+	std::vector<unsigned long long> exits;
+	std::vector<Move> path;
+	if (board.isSolved()) {
+		trace(m, path, result);
+		return;
+	}
+	// enters the current board at depth "d": mark it visited and list its moves
+	auto enter = [&](const std::size_t d, const std::size_t hash) {
+		seen.push_back(board);
+		STATS_TIMED(result.stats, HASH, visited.insert(&seen.back(), hash));
+		if (moves.size() <= d) {
+			moves.resize(d + 1);
+			next.resize(d + 1);
+			hashes.resize(d + 1);
+			exits.resize(d + 1);
+		}
+		STATS_TIMED(result.stats, MOVEGEN, Board::getAllMoves(board, moves[d]));
+		STATS(result.stats.expand(moves[d].size()));
+		next[d] = moves[d].size();
+		hashes[d] = hash;
+	};
+	enter(0, Board::hash(board));
 	// start search
-	while (!s.empty()) {
-		std::shared_ptr<Node> current = s.top();
-		s.pop();
-		// goal reached?
-		if (current->m.isSolved()) {
-			nodecount = visited.size();
-			goalNode = new Node(*current);
+	while (true) {
+		std::size_t d = path.size();
+		STATS(result.stats.open(d + 1));
+		// all children tried: back to the parent
+		if (next[d] == 0) {
+			if (d == 0) break;
+			Board::undoMove(board, path.back(), exits[d - 1]);
+			path.pop_back();
+			continue;
+		}
+		if (meter.exceeded(visited.size(), [&]() { return visited.bytes() + seen.size() * sizeof(State); })) {
+			result.nodecount = visited.size();
 			break;
 		}
-		// iterate over visited container
-		for (unsigned int i = 0; i < visited.size(); i++) {
-			// i > 0 for the first iteration, where ONLY the root node is in the visited list
-			if (i > 0 && visited.at(i)->m == current->m) { 
-				break;
-			}
-			// ..add node to "visited" if not & explore its children (add them to the stack for later evaluation)
-			if (i == visited.size() - 1) {
-				visited.push_back(current); // the break at the end of this block is necessary because of this line!!
-				// get all valid moves and add children nodes to stack if new
-				std::unordered_map<unsigned int, std::vector<Moves>> allMoves = current->m.getAllMoves();
-				std::unordered_map<unsigned int, std::vector<Moves>>::iterator it;
-				for (it = allMoves.begin(); it != allMoves.end(); ++it) {
-					for (unsigned int j = 0; j < it->second.size(); j++) {
-						// create a child Matrix
-						Matrix m_new = current->m.applyMoveCloning(it->first, it->second[j]);
-						m_new.normalize();
-						std::pair<int, Moves> transition(it->first, it->second[j]);
-						/* create a child Node
-						 * unique_ptr is sufficient here, because the instance is added to only one new owner (stack) */
-						std::unique_ptr<Node> child(new Node(m_new, current.get(), transition)); 
-						s.push(std::move(child)); // move ownership because the stack takes shared_ptr
-					}
-				}
-				break;
-			}
+		const Move& move = moves[d][--next[d]];
+		std::size_t childHash = STATS_TIMED(result.stats, HASH, Board::moveHash(board, hashes[d], move));
+		exits[d] = Board::applyMove(board, move);
+		// skip the child if its state was already explored..
+		if (STATS_TIMED(result.stats, HASH, visited.contains(board, childHash))) {
+			STATS(result.stats.duplicates++);
+			Board::undoMove(board, move, exits[d]);
+			continue;
 		}
+		path.push_back(move);
+		// goal reached?
+		if (board.isSolved()) {
+			result.nodecount = visited.size();
+			trace(m, path, result);
+			break;
+		}
+		// ..otherwise explore its children
+		enter(d + 1, childHash);
 	}
+	STATS(result.stats.closed(visited.size()));
 }
 
 
 // ITERATIVE DEEPENING DEPTH FIRST SEARCH
-void Search::iddfs(Matrix& m, const unsigned int limit) {
-	// root node
-	std::shared_ptr<Node> root(new Node(Matrix(m)));
+template <typename Board>
+void Search::iddfs(const State& m, Budget::Meter& meter, Result& result, const unsigned int limit) const {
+	// remembers the states of the current iteration (bounded memory)
+	TranspositionTable explored;
+	// the only board of the search. moves are applied and undone in place
+	State board(m);
+	std::size_t hash = Board::hash(board);
+	// the current path. never longer than the depth limit
+	std::vector<Move> path;
+	path.reserve(limit);
+	// one move list per depth, reused. deque: growing keeps references valid
+	std::deque<std::vector<Move>> moves;
 	// start search
 	for (unsigned int depth = 0; depth < limit; depth++) {
-		explored.push_back(std::pair<int, std::shared_ptr<Node>>(0, root));
-		Node *n = dls(*root.get(), depth);
-		// goal will be reached, if this is not a nullptr!
-		if (n) {
-			goalNode = new Node(*n);
+		/* explored states are forgotten before depth limit
+		 * is increased and search starts again */
+		explored.nextIteration();
+		explored.seen(hash, TranspositionTable::check(board), depth);
+		// goal will be reached, if this is true!
+		if (dls<Board>(board, hash, depth, explored, path, moves, meter, result)) {
+			trace(m, path, result);
 			break;
 		}
-		/* explored container is cleared before depth limit
-		 * is increased and search starts again */
-		explored.clear();
+		if (meter.stopped()) break;
 	}
 }
 
 
 // iterative deepening depth first helper function
-Node* Search::dls(Node& current, int depth) {
+template <typename Board>
+bool Search::dls(State& board, const std::size_t hash, int depth, TranspositionTable& explored,
+	std::vector<Move>& path, std::deque<std::vector<Move>>& moves, Budget::Meter& meter, Result& result) const {
 	// goal reached?
-	if (depth == 0 && current.m.isSolved()) {
-		return &current;
+	if (depth == 0 && board.isSolved()) {
+		return true;
 	}
 	if (depth > 0) {
 		// explore all children
-		std::unordered_map<unsigned int, std::vector<Moves>> allMoves = current.m.getAllMoves();
-		std::unordered_map<unsigned int, std::vector<Moves>>::iterator it;
-		for (it = allMoves.begin(); it != allMoves.end(); ++it) {
-			for (unsigned int j = 0; j < it->second.size(); j++) {
-				// create a child Matrix
-				Matrix m_new = current.m.applyMoveCloning(it->first, it->second[j]);
-				m_new.normalize();
-				std::pair<int, Moves> transition(it->first, it->second[j]);
-				// create a child Node
-				std::shared_ptr<Node> child(new Node(m_new, &current, transition));
-				// iterate over already explored nodes
-				for (unsigned int i = 0; i < explored.size(); i++) {
-					// search for duplicate state and if this state is further away from the root node
-					if (explored.at(i).second->m == child->m && explored.at(i).first > depth) {
-						break;
-					}
-					// add node to explored nodes
-					if (i == explored.size() - 1) {
-						nodecount++;
-						explored.push_back(std::pair<int, std::shared_ptr<Node>>(depth, child));
-						// recursive call
-						Node *ptr = dls(*child.get(), depth - 1);
-						if (ptr) {
-							return new Node(*ptr);
-						}
-						break;
-					}
-				}
+		std::size_t level = path.size();
+		if (moves.size() <= level) {
+			moves.resize(level + 1);
+		}
+		std::vector<Move>& list = moves[level];
+		STATS_TIMED(result.stats, MOVEGEN, Board::getAllMoves(board, list));
+		STATS(result.stats.expand(list.size()));
+		for (const Move& move : list) {
+			std::size_t childHash = STATS_TIMED(result.stats, HASH, Board::moveHash(board, hash, move));
+			// move the piece on the board
+			unsigned long long exits = Board::applyMove(board, move);
+			// skip states that were already searched with at least as much depth left
+			if (STATS_TIMED(result.stats, HASH,
+				explored.seen(childHash, TranspositionTable::check(board), depth - 1))) {
+				STATS(result.stats.duplicates++);
+				Board::undoMove(board, move, exits);
+				continue;
+			}
+			// on top of the path
+			path.push_back(move);
+			STATS(result.stats.open(path.size() + 1));
+			result.nodecount++;
+			// recursive call
+			if (dls<Board>(board, childHash, depth - 1, explored, path, moves, meter, result)) {
+				return true; // leaves the path (and board) as they are
 			}
+			path.pop_back();
+			Board::undoMove(board, move, exits);
+			// out of budget: unwind
+			if (meter.exceeded(result.nodecount, [&]() { return explored.bytes(); })) return false;
 		}
 	}
-	return nullptr;
+	return false;
 }
 
 
 // A* SEARCH
-void Search::astar(Matrix& m, const int heuristic(Matrix&)) {
-	// priority queue as container, to always continue exploring the most promising node
-	std::priority_queue<std::shared_ptr<CostNode>, std::vector<std::shared_ptr<CostNode>>, CostNode::LessThanByTotalCost> pq;
-	std::vector<std::shared_ptr<CostNode>> visited;
+template <typename Open, typename Board>
+void Search::astar(const State& m, const Heuristic::Function heuristic, const Heuristic::Context& context,
+	Budget::Meter& meter, Result& result) const {
+	// open list ordered by cost, to always continue exploring the most promising node
+	Open pq;
+	// owns the nodes. the priority queue holds their indices
+	NodeArena<CostNode> nodes;
+	// state -> index in "nodes", to find a known state reached with a lower g
+	StateMap<unsigned int> index;
+	// per node: on the open list. older entries of a node whose g improved since are skipped
+	std::vector<char> open;
+	// reused for every expansion
+	std::vector<Move> moves;
 	// root (cost is heuristic only, because g(0) = 0)
-	std::shared_ptr<CostNode> root(new CostNode(Matrix(m)));
-	root->cost = heuristic(root->m);
-	pq.push(root);
-	visited.push_back(root);
+	unsigned int root = nodes.add(CostNode(m));
+	nodes[root].cost = heuristic(nodes[root].state, context);
+	pq.push(nodes[root].cost, root);
+	index.insert(&nodes[root].state, Board::hash(m), root);
+	open.push_back(1);
 	// start search
 	while (!pq.empty()) {
-		std::shared_ptr<CostNode> current = pq.top();
-		pq.pop();
+		if (meter.exceeded(index.size(), [&]() {
+			return nodes.bytes() + index.bytes() + open.size() + pq.size() * sizeof(CostNode::Entry);
+		})) {
+			result.nodecount = index.size();
+			break;
+		}
+		STATS(result.stats.open(pq.size()));
+		unsigned int current = pq.top();
+		STATS_TIMED(result.stats, QUEUE, pq.pop());
+		if (!open[current]) continue;
+		open[current] = 0;
 		// goal reached?
-		if (current->m.isSolved()) {
-			nodecount = visited.size();
-			goalNode = new CostNode(*current);
+		if (nodes[current].state.isSolved()) {
+			result.nodecount = index.size();
+			extract(nodes, current, result);
 			break;
 		}
-		// get all valid moves and add children nodes to priority queue if new
-		std::unordered_map<unsigned int, std::vector<Moves>> allMoves = current->m.getAllMoves();
-		std::unordered_map<unsigned int, std::vector<Moves>>::iterator it;
-		for (it = allMoves.begin(); it != allMoves.end(); ++it) {
-			for (unsigned int j = 0; j < it->second.size(); j++) {
-				// create a child Matrix
-				Matrix m_new = current->m.applyMoveCloning(it->first, it->second[j]);
-				m_new.normalize();
-				std::pair<int, Moves> transition(it->first, it->second[j]);
-				// create a child CostNode
-				std::shared_ptr<CostNode> child(new CostNode(m_new, current.get(), transition));
-				/* if child was not already visited calculate it's cost,
-				 * then add it to the visited list and the priority queue */
-				if (!std::any_of(visited.begin(), visited.end(),
-					[&child](const std::shared_ptr<Node>& n) { return child->m == n->m; })) {
-					int g = child->getParentCount();
-					int h = heuristic(m_new);
-					child->cost = g + h; // f(n) = g(n) [step cost] + h(n) [heuristic]
-					visited.push_back(child);
-					pq.push(child);
+		// get all valid moves and add children nodes to priority queue if new or reached cheaper
+		std::size_t hash = STATS_TIMED(result.stats, HASH, Board::hash(nodes[current].state));
+		STATS_TIMED(result.stats, MOVEGEN, Board::getAllMoves(nodes[current].state, moves));
+		STATS(result.stats.expand(moves.size()));
+		for (const Move& move : moves) {
+			// create a child State. duplicates are rejected before normalizing it
+			std::size_t childHash = STATS_TIMED(result.stats, HASH, Board::moveHash(nodes[current].state, hash, move));
+			State m_new = Board::applyMoveCloning(nodes[current].state, move);
+			std::pair<int, Moves> transition(move.piece.label, move.dir);
+			const int g = nodes[current].g + 1;
+			const unsigned int* found = STATS_TIMED(result.stats, HASH, index.find(m_new, childHash));
+			if (found) {
+				CostNode& known = nodes[*found];
+				if (known.g <= g) {
+					STATS(result.stats.duplicates++);
+					continue;
 				}
+				/* shorter path to a known state: reopen it. the heuristic does
+				 * not change, so f drops by as much as g */
+				known.cost -= known.g - g;
+				known.g = g;
+				known.parent = current;
+				known.trans = transition;
+				open[*found] = 1;
+				STATS_TIMED(result.stats, QUEUE, pq.push(known.cost, *found));
+				continue;
 			}
+			STATS_TIMED(result.stats, NORMALIZE, Board::normalize(m_new));
+			/* create a child CostNode. child was not visited yet: calculate
+			 * it's cost, then add it to the visited list and the priority queue */
+			unsigned int idx = nodes.add(CostNode(m_new, current, transition));
+			CostNode& child = nodes[idx];
+			child.g = g;
+			// f(n) = g(n) [step cost] + h(n) [heuristic]
+			child.cost = child.g + STATS_TIMED(result.stats, HEURISTIC, heuristic(child.state, context));
+			STATS_TIMED(result.stats, HASH, index.insert(&child.state, childHash, idx));
+			open.push_back(1);
+			STATS_TIMED(result.stats, QUEUE, pq.push(child.cost, idx));
+		}
+	}
+	STATS(result.stats.closed(index.size()));
+}
+
+
+// IDA* SEARCH
+template <typename Board>
+void Search::idastar(const State& m, const Heuristic::Function heuristic, const Heuristic::Context& context,
+	Budget::Meter& meter, Result& result) const {
+	// the only board of the search. moves are applied and undone in place
+	State board(m);
+	TranspositionTable explored;
+	std::vector<Move> path;
+	// one move list per depth, reused. deque: growing keeps references valid
+	std::deque<std::vector<Move>> moves;
+	// f-bound of the first iteration is the heuristic of the root
+	int bound = heuristic(board, context);
+	while (true) {
+		explored.nextIteration();
+		int t = ida<Board>(board, Board::hash(board), 0, bound, heuristic, context, explored, path, moves, meter,
+			result);
+		if (t == FOUND) {
+			trace(m, path, result);
+			return;
+		}
+		if (t == INT_MAX || meter.stopped()) {
+			return; // no solution (within the budget)
+		}
+		// next bound is the lowest f that exceeded the current one
+		bound = t;
+	}
+}
+
+
+// IDA* helper function. returns FOUND or the lowest f above the bound
+template <typename Board>
+int Search::ida(State& board, const std::size_t hash, const int g, const int bound,
+	const Heuristic::Function heuristic, const Heuristic::Context& context, TranspositionTable& explored,
+	std::vector<Move>& path, std::deque<std::vector<Move>>& moves, Budget::Meter& meter, Result& result) const {
+	int f = g + STATS_TIMED(result.stats, HEURISTIC, heuristic(board, context));
+	if (f > bound) {
+		return f;
+	}
+	if (board.isSolved()) {
+		return FOUND;
+	}
+	// already searched in this iteration with at least as much bound left?
+	if (STATS_TIMED(result.stats, HASH, explored.seen(hash, TranspositionTable::check(board), bound - g))) {
+		STATS(result.stats.duplicates++);
+		return INT_MAX;
+	}
+	result.nodecount++;
+	STATS(result.stats.open(g + 1));
+	if (moves.size() <= (std::size_t) g) {
+		moves.resize(g + 1);
+	}
+	std::vector<Move>& list = moves[g];
+	STATS_TIMED(result.stats, MOVEGEN, Board::getAllMoves(board, list));
+	STATS(result.stats.expand(list.size()));
+	int min = INT_MAX;
+	for (const Move& move : list) {
+		/* moving the last piece straight back is never useful. except for the
+		 * master brick: it may just have covered exit cells it leaves free */
+		if (!path.empty() && path.back().piece.label == move.piece.label && move.piece.label != 2 &&
+			path.back().dir == inverse(move.dir)) {
+			continue;
+		}
+		std::size_t childHash = STATS_TIMED(result.stats, HASH, Board::moveHash(board, hash, move));
+		unsigned long long exits = Board::applyMove(board, move);
+		path.push_back(move);
+		int t = ida<Board>(board, childHash, g + 1, bound, heuristic, context, explored, path, moves, meter, result);
+		if (t == FOUND) {
+			return FOUND; // leaves the path (and board) as they are
 		}
+		path.pop_back();
+		Board::undoMove(board, move, exits);
+		if (t < min) min = t;
+		// out of budget: unwind
+		if (meter.exceeded(result.nodecount, [&]() { return explored.bytes(); })) return INT_MAX;
 	}
-}
\ No newline at end of file
+	return min;
+}
+
+
+// ANYTIME WEIGHTED A* SEARCH (ARA*)
+template <typename Board>
+void Search::arastar(const State& m, const Heuristic::Function heuristic, const Heuristic::Context& context,
+	Budget::Meter& meter, const Improvement& improved, Result& result) const {
+	auto start = std::chrono::steady_clock::now();
+	// owns the nodes. cost = g + h (unweighted), thus h = cost - g
+	NodeArena<CostNode> nodes;
+	StateMap<unsigned int> index;
+	/* per node: OPEN (on the open list), CLOSED (expanded with the current
+	* weight), INCONS (improved after its expansion) or SEEN (none of these) */
+	enum Where : char { SEEN, OPEN, CLOSED, INCONS };
+	std::vector<char> where;
+	std::vector<unsigned int> incons;
+	HeapOpenList pq;
+	std::vector<Move> moves;
+	int weight = ARA_WEIGHT;
+	// f = g + w * h, in 1/ARA_SCALE
+	auto key = [&](const CostNode& n) {
+		return ARA_SCALE * n.g + weight * (n.cost - n.g);
+	};
+	// best goal node so far and the length of the last reported solution
+	unsigned int goal = NodeArena<CostNode>::NONE;
+	int reported = INT_MAX;
+	double reportedBound = INFINITY;
+	// a heuristic may be negative on solved states (manhatten, blocking)
+	auto h = [&](const State& s) {
+		return std::max(0, STATS_TIMED(result.stats, HEURISTIC, heuristic(s, context)));
+	};
+	unsigned int root = nodes.add(CostNode(m));
+	nodes[root].cost = h(m);
+	index.insert(&nodes[root].state, Board::hash(m), root);
+	where.push_back(OPEN);
+	pq.push(key(nodes[root]), root);
+	if (m.isSolved()) goal = root;
+	bool stopped = false;
+	while (true) {
+		/* IMPROVE PATH: expand until no open node promises a shorter
+		* solution than the best goal under the current weight */
+		while (!pq.empty()) {
+			unsigned int current = pq.top();
+			if (where[current] != OPEN) {
+				pq.pop();
+				continue;
+			}
+			if (goal != NodeArena<CostNode>::NONE && ARA_SCALE * nodes[goal].g <= key(nodes[current])) break;
+			// out of budget: the best solution so far is the result
+			if (meter.exceeded(index.size(), [&]() {
+				return nodes.bytes() + index.bytes() + where.size() + incons.size() * sizeof(unsigned int)
+					+ pq.size() * sizeof(CostNode::Entry);
+			})) {
+				stopped = true;
+				break;
+			}
+			STATS(result.stats.open(pq.size()));
+			STATS_TIMED(result.stats, QUEUE, pq.pop());
+			where[current] = CLOSED;
+			// solved states end a path, they are not expanded
+			if (nodes[current].state.isSolved()) continue;
+			std::size_t hash = STATS_TIMED(result.stats, HASH, Board::hash(nodes[current].state));
+			STATS_TIMED(result.stats, MOVEGEN, Board::getAllMoves(nodes[current].state, moves));
+			STATS(result.stats.expand(moves.size()));
+			for (const Move& move : moves) {
+				std::size_t childHash = STATS_TIMED(result.stats, HASH, Board::moveHash(nodes[current].state, hash, move));
+				State m_new = Board::applyMoveCloning(nodes[current].state, move);
+				std::pair<int, Moves> transition(move.piece.label, move.dir);
+				const int g = nodes[current].g + 1;
+				const unsigned int* found = STATS_TIMED(result.stats, HASH, index.find(m_new, childHash));
+				unsigned int idx;
+				if (found) {
+					idx = *found;
+					CostNode& known = nodes[idx];
+					if (known.g <= g) {
+						STATS(result.stats.duplicates++);
+						continue;
+					}
+					known.cost -= known.g - g;
+					known.g = g;
+					known.parent = current;
+					known.trans = transition;
+					// expanded with this weight already: wait for the next one
+					if (where[idx] == CLOSED || where[idx] == INCONS) {
+						if (where[idx] == CLOSED) incons.push_back(idx);
+						where[idx] = INCONS;
+					}
+					else {
+						where[idx] = OPEN;
+						STATS_TIMED(result.stats, QUEUE, pq.push(key(known), idx));
+					}
+				}
+				else {
+					STATS_TIMED(result.stats, NORMALIZE, Board::normalize(m_new));
+					idx = nodes.add(CostNode(m_new, current, transition));
+					CostNode& child = nodes[idx];
+					child.g = g;
+					child.cost = g + h(child.state);
+					STATS_TIMED(result.stats, HASH, index.insert(&child.state, childHash, idx));
+					where.push_back(OPEN);
+					STATS_TIMED(result.stats, QUEUE, pq.push(key(child), idx));
+				}
+				if (nodes[idx].state.isSolved() && (goal == NodeArena<CostNode>::NONE || g < nodes[goal].g)) {
+					goal = idx;
+				}
+			}
+		}
+		if (goal == NodeArena<CostNode>::NONE) break; // no solution (yet)
+		/* bound: the solution against the lowest g + h of all states that
+		* could still lead to a shorter one (a lower bound of the optimum) */
+		int lowest = INT_MAX;
+		for (std::size_t i = 0; i < where.size(); i++) {
+			if ((where[i] == OPEN || where[i] == INCONS) && nodes[(unsigned int) i].cost < lowest) {
+				lowest = nodes[(unsigned int) i].cost;
+			}
+		}
+		const int length = nodes[goal].g;
+		// the weight only bounds a solution once the expansions under it are complete
+		double bound = stopped ? INFINITY : (double) weight / ARA_SCALE;
+		if (lowest == INT_MAX || lowest >= length) bound = 1;
+		else if (lowest > 0) bound = std::min(bound, (double) length / lowest);
+		// no bound (INFINITY) without an admissible heuristic
+		if (!admissible(heuristic)) bound = INFINITY;
+		if (length < reported || bound < reportedBound) {
+			reported = length;
+			reportedBound = bound;
+			result.nodecount = index.size();
+			extract(nodes, goal, result);
+			result.bound = std::isinf(bound) ? 0 : bound;
+			if (improved) {
+				result.time = std::chrono::duration_cast<std::chrono::milliseconds>(
+					std::chrono::steady_clock::now() - start).count() / 1000.0f;
+				improved(result);
+			}
+		}
+		if (stopped || bound == 1 || weight <= ARA_SCALE) break;
+		// next weight: the improved states join the open list, all keys change
+		weight = std::max(ARA_SCALE, weight - ARA_STEP);
+		pq = HeapOpenList();
+		for (unsigned int i : incons) {
+			where[i] = OPEN;
+		}
+		incons.clear();
+		for (std::size_t i = 0; i < where.size(); i++) {
+			if (where[i] == CLOSED) where[i] = SEEN;
+			if (where[i] == OPEN) pq.push(key(nodes[(unsigned int) i]), (unsigned int) i);
+		}
+	}
+	result.nodecount = index.size();
+	STATS(result.stats.closed(index.size()));
+}
+
+
+void Search::trace(const State& root, const std::vector<Move>& path, Result& result) {
+	/* the moves use the labels of the unnormalized board. replay them and
+	 * report every move with the labels of the normalized state, like the
+	 * other algorithms do */
+	result.path = Path(root);
+	State raw(root);
+	State normalized(root);
+	for (const Move& move : path) {
+		Move step = move;
+		step.piece.label = (signed char) normalized.at(move.piece.row, move.piece.col);
+		result.path.moves.push_back(step);
+		raw.applyMove(move);
+		normalized = raw;
+		normalized.normalize();
+	}
+	result.found = true;
+}
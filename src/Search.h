@@ -1,26 +1,53 @@
 #pragma once
 #include "CostNode.h"
+#include "Path.h"
+#include "Stats.h"
+#include "Budget.h"
+#include "PatternDatabase.h"
+#include "TranspositionTable.h"
+#include "SolutionCache.h"
 #include <map>
+#include <deque>
+#include <climits>
 #include <chrono>
+#include <functional>
 #include <cmath> // for abs(float)
+#include <algorithm>
 
 class Search {
 
 public:
 	/* SEARCH ALGORITHMS
-	* RAND  =  random walk (prints it's own output!)
+	* RAND  =  random walk (the moves it made are the "path", see Result)
 	* BFS   =  breadth first search
 	* DFS   =  depth first search
 	* IDDFS =  iterative deepening depth first search
-	* ASTAR =  A* search   */
-	enum Algorithm { RAND, BFS, DFS, IDDFS, ASTAR };
+	* ASTAR =  A* search
+	* ASTAR_BUCKETS = A* search on an array of buckets (one per f value) instead of a binary heap
+	* HDASTAR = hash distributed A* (multi-threaded, optimal with admissible heuristics)
+	* PBFS  =  level-synchronous parallel breadth first search (multi-threaded)
+	* IDASTAR = iterative deepening A* (bounded memory)
+	* ARASTAR = anytime weighted A* (ARA*). a first solution fast with an inflated heuristic,
+	*           then better ones as the weight drops to 1 (see Improvement) */
+	enum Algorithm { RAND, BFS, DFS, IDDFS, ASTAR, HDASTAR, PBFS, IDASTAR, ASTAR_BUCKETS, ARASTAR };
 	/* Implementations for different heuristic functions
 	* encapsulated in a struct
 	* (currently used for A* search algorithm only)
 	* To add a new heuristic:
 	*   - add its implementation to this struct in a new function
-	*     the function argument must be "Matrix&" and the return type must be "const int"*/
+	*     the function arguments must be "const State&, const Context&" and the return type must be "const int"*/
 	struct Heuristic {
+		/* what a heuristic is evaluated with besides the State. run() fills
+		* it for the board it searches */
+		struct Context {
+			// pattern database of the layout of the board (Heuristic::pattern). nullptr = none
+			const PatternDatabase* patterns;
+
+			explicit Context(const PatternDatabase* patterns = nullptr) : patterns(patterns) {};
+		};
+		// a heuristic function
+		typedef const int (*Function)(const State&, const Context&);
+
 		/* Manhatten distance between master brick and goal
 		* The distance is calculated between the center of the master brick
 		* and the center of the goal. The function disregards other bricks!
@@ -28,7 +55,7 @@ public:
 		* the master brick with the goal fully if they are of the same
 		* dimensions or partially if they're not. Works for master brick 1x1, 1x2, 2x1 and 2x2
 		* returns 0 if master brick (2) overlaps the goal (-1) */
-		static const int manhatten(Matrix& m) {
+		static const int manhatten(const State& m, const Context&) {
 			float sumX = 0, sumY = 0;
 			// biased master index
 			std::vector<std::pair<int, int>> master_indices = m.getPieceIndices(2);
@@ -86,13 +113,12 @@ public:
 		*  +---------+    +---------+    +---------+    +-G-------+
 		*  3 blocking     4 blocking     3 blocking     0 blocking
 		*
-		*  This heuristic is ADMISSIBLE, because the # of blocked cells
-		*  can only decrease towards the goal. If the master brick is moved
-		*  closer towards the goal, there are fewer cells to be evaluated.
-		*  Therefore, the total number of blocked cells cannot increase in this case.
-		*  The # of blocked cells could increase, if an empty cell (0) swaps its place
-		*  with a cell that contains a value > 2. The resulting state would not push
-		*  the search closer to the goal but further away.
+		*  This heuristic OVERESTIMATES (it is not admissible): any blocked cell
+		*  adds +3 (see below), so a board one move of a blocking piece and one
+		*  of the master away from the goal gets 4 or more. Even the plain count
+		*  is no lower bound, one move can clear several cells of a piece.
+		*  A* and IDA* with it may return longer solutions than the shortest
+		*  one (Search::optimal), and ARA* reports no bound.
 		*
 		*  This heuristic proves to be better than the Manhatten distance,
 		*  because it does not ignore the board configuration. It is important
@@ -101,148 +127,254 @@ public:
 		*  blocking cell" area and/or moving the master brick closer to the goal.
 		*
 		*  */
-		static const int blocking(Matrix& m) {
-			/* MASTER */
-			std::vector<std::pair<int, int>> master_indices = m.getPieceIndices(2);
-			std::pair<int, int> master_dim = m.getPieceDim(master_indices);
-			int mX = master_indices.at(0).first; // master top left piece index x
-			int mY = master_indices.at(0).second; // master top left piece index y
-			int mW = master_dim.first; // master width
-			int mH = master_dim.second; // master height
+		static const int blocking(const State& m, const Context&) {
+			const int w = m.width, h = m.height;
+			/* MASTER (a rectangle: first and last cell of its mask are opposite corners) */
+			const std::uint64_t master = m.mask(2);
+			int mX = Kernels::lowest(master) % w; // master top left piece index x
+			int mY = Kernels::lowest(master) / w; // master top left piece index y
+			int mW = Kernels::highest(master) % w - mX + 1; // master width
+			int mH = Kernels::highest(master) / w - mY + 1; // master height
 			/* GOAL */
-			std::vector<std::pair<int, int>> goal_indices = m.getPieceIndices(-1);
-			if (goal_indices.size() == 0)
+			const std::uint64_t goal = m.mask(-1);
+			if (goal == 0)
 				return -2; // goal is reached. return low enough value to end search faster
-			std::pair<int, int> goal_dim = m.getPieceDim(goal_indices);
-			int gX = goal_indices.at(0).first; // goal top left piece index x
-			int gY = goal_indices.at(0).second; // goal top left piece index y
-			int gW = goal_dim.first; // goal width
-			int gH = goal_dim.second; // goal height
-
-			/* counting blocking cells in the area between master brick and goal
-			 * probably not the shortest solution, but somewhat lucid this way
-			 * Besides, this works so TOUCH AT YOUR OWN RISK */
-			int count = 0;
+			int gX = Kernels::lowest(goal) % w; // goal top left piece index x
+			int gY = Kernels::lowest(goal) / w; // goal top left piece index y
+			// goal width and height, counted like State::getPieceDim
+			int gW = 0, gH = 0, tmpX = -1, tmpY = -1;
+			for (std::uint64_t rest = goal; rest; rest &= rest - 1) {
+				int i = Kernels::lowest(rest);
+				if (i % w > tmpX) { tmpX = i % w; gW++; }
+				if (i / w > tmpY) { tmpY = i / w; gH++; }
+			}
+
+			/* counting blocking cells (> 2) in the area between master brick and goal:
+			 * one rectangle of the board, see the examples above */
+			int top = 0, bottom = 0, left = 0, right = 0;
 			if (mX == gX && mY != gY) {
-				if (mY > gY) { // UP
-					for (int i = mX; i < mX + mW; i++) {
-						for (int j = mY; j > 0; j--) {
-							if (m.at(j, i) > 2) count++;
-						}
-					}
-				}
-				else if (mY < gY) { // DOWN
-					for (int i = mX; i < mX + mW; i++) {
-						for (int j = mY; j < m.height - 1; j++) {
-							if (m.at(j, i) > 2) count++;
-						}
-					}
-				}
+				left = mX; right = mX + mW;
+				if (mY > gY) { top = 1; bottom = mY + 1; } // UP
+				else { top = mY; bottom = h - 1; } // DOWN
 			}
 			else if (mY == gY && mX != gX) {
-				if (mX > gX) { // LEFT
-					for (int i = mX; i > 0; i--) {
-						for (int j = mY; j < mY + mH; j++) {
-							if (m.at(j, i) > 2) count++;
-						}
-					}
-				}
-				else if (mX < gX) { // RIGHT
-					for (int i = mX; i < m.width - 1; i++) {
-						for (int j = mY; j < mY + mH; j++) {
-							if (m.at(j, i) > 2) count++;
-						}
-					}
-				}
+				top = mY; bottom = mY + mH;
+				if (mX > gX) { left = 1; right = mX + 1; } // LEFT
+				else { left = mX; right = w - 1; } // RIGHT
 			}
 			else if (mX != gX && mY != gY) {
-				int mX_gX = mX - gX;
-				int mY_gY = mY - gY;
-				if (mX_gX < 0 && mY_gY < 0) { // RIGHT, DOWN
-					for (int i = 1; i < m.width - 1; i++) {
-						for (int j = 1; j < m.height - 1; j++) {
-							if (i >= mX && i < gX + gW && j >= mY && j < gY + gH) {
-								if (m.at(j, i) > 2) count++;
-							}
-						}
-					}
-				}
-				if (mX_gX > 0 && mY_gY < 0) { // LEFT, DOWN
-					for (int i = 1; i < m.width - 1; i++) {
-						for (int j = 1; j < m.height - 1; j++) {
-							if (i < mX + mW && i >= gX && j >= mY && j < gY + gH) {
-								if (m.at(j, i) > 2) count++;
-							}
-						}
-					}
-				}
-				if (mX_gX < 0 && mY_gY > 0) { // RIGHT, UP
-					for (int i = 1; i < m.width - 1; i++) {
-						for (int j = 1; j < m.height - 1; j++) {
-							if (i >= mX && i < gX + gW && j < mY + mH && j >= gY) {
-								if (m.at(j, i) > 2) count++;
-							}
-						}
-					}
-				}
-				if (mX_gX > 0 && mY_gY > 0) { // LEFT,  UP
-					for (int i = 1; i < m.width - 1; i++) {
-						for (int j = 1; j < m.height - 1; j++) {
-							if (i < mX + mW && i >= gX && j < mY + mH && j >= gY) {
-								if (m.at(j, i) > 2) count++;
-							}
-						}
-					}
-				}
+				// RIGHT or LEFT, DOWN or UP. inside the walls
+				left = std::max(1, mX < gX ? mX : gX);
+				right = std::min(w - 1, mX < gX ? gX + gW : mX + mW);
+				top = std::max(1, mY < gY ? mY : gY);
+				bottom = std::min(h - 1, mY < gY ? gY + gH : mY + mH);
 			}
+			int count = Kernels::count(m.maskAbove(2) & Kernels::rectangle(w, top, bottom, left, right));
 			/* this assigns a higher cost to board configurations
 			* that block the master brick, thus pushing more towards
 			* the goal. Had to be at least +3 (not 100% sure why..) */
 			if (count != 0) count += 3;
 			return count;
 		}
+		/* exact # of moves of the master brick and some groups of pieces to the
+		* goal, with all other pieces removed, the maximum over several such
+		* abstractions (pattern database, see PatternDatabase.h). admissible and
+		* consistent. the database comes with the Context: run() gets the one
+		* of the board from the Store of the Search, or builds one for the run
+		* without a Store (this takes a moment on the large levels and counts
+		* towards the budget). 0 without one, e.g. on boards whose exits the
+		* master covers one by one (see PatternDatabase::build) */
+		static const int pattern(const State& m, const Context& context) {
+			return context.patterns ? context.patterns->distance(m) : 0;
+		}
 	};
 
-	// no fancy constructors/destructors necessary
-	Search() {};
+	/* result of a search run. Each run returns its own Result,
+	* thus one Search instance can run several searches at the same time
+	* (e.g. from multiple threads). "path" is only valid if "found" is set.
+	* No solution leaves it empty. The random walk keeps the moves it made,
+	* "found" is set if they end on a solved board.
+	* A search stopped by its Budget sets "exceeded", with "nodecount" and
+	* "stats" up to that point (ARA* keeps its best solution so far) */
+	struct Result {
+		// solution: start state and moves
+		Path path;
+		bool found;
+		// # of nodes explored
+		int nodecount;
+		// time the search took in s
+		float time;
+		/* suboptimality bound: the solution is at most "bound" times as long as
+		* a shortest one. 1 = optimal, 0 = unknown (e.g. DFS, inadmissible heuristic) */
+		double bound;
+		// counters and phase timers (see Stats.h). zero unless compiled with SBP_STATS
+		Stats stats;
+		// the limit of the Budget that stopped the search. NONE: it ran to its end
+		Budget::Exceeded exceeded;
+
+		Result() : found(false), nodecount(0), time(0), bound(0), exceeded(Budget::NONE) {};
+
+		const bool solved() const {
+			return found;
+		}
+		// # of moves of the solution. -1 if there is none
+		const int length() const {
+			return found ? (int) path.size() : -1;
+		}
+	};
+
+	/* called by ARASTAR with every better solution (in "path", bound and
+	* time so far set), on the thread that runs the search */
+	typedef std::function<void(const Result&)> Improvement;
+
+	/* "cache" (optional, shared) answers states of earlier optimal
+	* solutions without a search, and keeps the optimal solutions found.
+	* "fixedSizes" runs the sequential algorithms on boards of the sizes of the
+	* levels (5x4, 6x6, 6x7) with code compiled for that size (see Board.h).
+	* false: always the generic code (same results, for comparison).
+	* "patterns" (optional, shared) keeps the pattern databases of the layouts
+	* for Heuristic::pattern (see PatternDatabase::Store). nullptr: each run
+	* builds its own */
+	Search(SolutionCache* cache = nullptr, const bool fixedSizes = true, PatternDatabase::Store* patterns = nullptr)
+		: cache(cache), fixedSizes(fixedSizes), patterns(patterns) {};
 	~Search() {};
 
-	// run a selected search algorithm first...
-	void run(const Matrix, const Search::Algorithm, const int heuristic(Matrix&) = Heuristic::manhatten);
-	/* ...then print results (not for random walk!)
+	/* run a selected search algorithm first...
+	 * "threads" is used by multi-threaded algorithms only. 0 = one per hardware thread.
+	 * "budget" limits time, stored states and memory of every algorithm and
+	 * can cancel it (see Budget.h). "improved" is used by ARASTAR only */
+	Result run(const Matrix, const Search::Algorithm, const Heuristic::Function heuristic = Heuristic::manhatten,
+		const unsigned int threads = 0, const Budget& budget = Budget(), const Improvement& improved = nullptr) const;
+	// same for a packed board (e.g. from a Corpus), without the Matrix round trip
+	Result run(const State&, const Search::Algorithm, const Heuristic::Function heuristic = Heuristic::manhatten,
+		const unsigned int threads = 0, const Budget& budget = Budget(), const Improvement& improved = nullptr) const;
+	/* layer sizes of a breadth first search. "depth" is the solution
+	* length (-1 if there is none), layers[d] the # of states at depth d.
+	* A count stopped by its Budget sets "exceeded" and keeps the complete
+	* layers up to that point */
+	struct LayerCount {
+		int depth;
+		std::vector<std::size_t> layers;
+		// time the search took in s
+		float time;
+		// the limit of the Budget that stopped the count. NONE: it ran to its end
+		Budget::Exceeded exceeded;
+
+		LayerCount() : depth(-1), time(0), exceeded(Budget::NONE) {};
+	};
+	/* parallel breadth first search that only counts. Keeps the last three
+	* layers in memory instead of the whole tree (all of them on boards whose
+	* exit the master brick can cover a part of, see State::exitsAtOnce).
+	* stopAtGoal = false continues to the end of the reachable state space.
+	* "budget" limits it like a search (nodes: the states of all layers) */
+	LayerCount countLayers(const Matrix, const bool stopAtGoal = true, const unsigned int threads = 0,
+		const Budget& budget = Budget()) const;
+	/* same count with the layers on disk (see ExternalBFS.cpp), for state
+	* spaces that do not fit into memory. "directory" holds the temporary
+	* layer files, in a new directory per call (several counts may share it).
+	* "memory" is the max # of states kept in memory at once. "budget" counts
+	* the states of all layers as nodes and the memory buffer as bytes.
+	* returns false if the files cannot be written */
+	bool countLayersExternal(const Matrix, const std::string& directory, LayerCount&,
+		const std::size_t memory = 1 << 20, const bool stopAtGoal = true, const Budget& budget = Budget()) const;
+	/* ...then print results (to std::cout unless told otherwise).
+	 * Nothing else of Search writes anywhere.
 	 * on top of the default "nodecount", "time" and "length"
 	 * output, printSteps = true will output a step by step solution*/
-	void printResults(const bool printSteps = false);
+	static void printResults(const Result&, const bool printSteps = false, std::ostream& os = std::cout);
 
 
 private:
-	/* "goalNode" and "nodecount" MUST be set by search
-	* algorithm function (on completion) before returning.
-	* Otherwise results will not print.
-	* "time" is measured automatically */
-	Node* goalNode;
-	// # of nodes explored
-	int nodecount;
-	// time the search took in s 
-	float time; 
+	SolutionCache* cache;
+	const bool fixedSizes;
+	PatternDatabase::Store* patterns;
+	// checks if an algorithm (with a heuristic) always finds optimal solutions
+	static const bool optimal(const Search::Algorithm, const Heuristic::Function heuristic);
+	// checks if a heuristic never overestimates (blocking does, see there)
+	static const bool admissible(const Heuristic::Function heuristic);
 
+	/** SEARCH ALGORITHMS **/
+	/* the solution ("path", "found") and "nodecount" of the Result MUST be
+	* set by the search algorithm function (on completion) before returning.
+	* Otherwise results will not print.
+	* "time" is measured automatically.
+	* Each algorithm checks the Meter in its hot loop (Meter::exceeded) and
+	* returns without a solution when it says so. run() sets Result::exceeded */
 
-	// resets the member variables (not goalNode)
-	void reset();
-
+	/* runs BFS, DFS, IDDFS, A* (both open lists), IDA* or ARA* with the board
+	* operations compiled for the size of the board if there are some
+	* (FixedBoard), with the generic ones (AnyBoard) otherwise */
+	void sequential(const State&, const Search::Algorithm, const Heuristic::Function heuristic,
+		const Heuristic::Context&, Budget::Meter&, const Improvement&, Result&) const;
+	// same with the board operations "Board" (see Board.h). the algorithms below take it, too
+	template <typename Board>
+	void sequential(const State&, const Search::Algorithm, const Heuristic::Function heuristic,
+		const Heuristic::Context&, Budget::Meter&, const Improvement&, Result&) const;
 
-	/** SEARCH ALGORITHMS **/
-	
-	// random walk (prints its output itself!)
-	void randomWalk(Matrix&, const unsigned int = 3);
+	// random walk of at most n moves. stops early on a solved board
+	void randomWalk(const State&, Result&, const unsigned int n = 3) const;
 	// breadth first
-	void bfs(Matrix&);
+	template <typename Board>
+	void bfs(const State&, Budget::Meter&, Result&) const;
 	// depth first
-	void dfs(Matrix&);
+	template <typename Board>
+	void dfs(const State&, Budget::Meter&, Result&) const;
 	// iterative deepening depth first. depth limited to 100 (plenty!)
-	void iddfs(Matrix&, const unsigned int = 100);
-	Node* dls(Node&, int);
-	std::vector<std::pair<int, std::shared_ptr<Node>>> explored;
-	// A*. takes a function pointer for a heuristic function
-	void astar(Matrix&, const int heuristic(Matrix&));
+	template <typename Board>
+	void iddfs(const State&, Budget::Meter&, Result&, const unsigned int = 100) const;
+	/* depth limited helper. works on a single board (apply/undo), "path" holds
+	* the moves to it, "moves" one move list per depth (reused), "explored" the
+	* states of the current iteration. returns true (path to the goal in "path") */
+	template <typename Board>
+	bool dls(State& board, const std::size_t hash, int, TranspositionTable& explored,
+		std::vector<Move>& path, std::deque<std::vector<Move>>& moves, Budget::Meter&, Result&) const;
+	/* A*. takes a function pointer for a heuristic function.
+	* "Open" is the open list (HeapOpenList or BucketOpenList, see OpenList.h).
+	* "Board" the board operations (see Board.h), like in bfs, dfs, iddfs and IDA*.
+	* a known state reached with a lower g is reopened, so the solution is
+	* optimal with an admissible heuristic */
+	template <typename Open, typename Board>
+	void astar(const State&, const Heuristic::Function heuristic, const Heuristic::Context&, Budget::Meter&,
+		Result&) const;
+	/* IDA*. the heuristic is the f-bound. works on a single board (apply/undo)
+	* with a fixed-size transposition table, thus memory stays bounded */
+	template <typename Board>
+	void idastar(const State&, const Heuristic::Function heuristic, const Heuristic::Context&, Budget::Meter&,
+		Result&) const;
+	// IDA* helper. returns FOUND or the lowest f above the bound
+	template <typename Board>
+	int ida(State&, const std::size_t hash, const int g, const int bound, const Heuristic::Function heuristic,
+		const Heuristic::Context&, TranspositionTable&, std::vector<Move>& path, std::deque<std::vector<Move>>& moves,
+		Budget::Meter&, Result&) const;
+	static const int FOUND = INT_MIN;
+	/* anytime weighted A* (ARA*). searches with f = g + w * h, starting with
+	* w = ARA_WEIGHT, and lowers w by ARA_STEP after every solution. states
+	* improved after their expansion wait for the next w (no re-expansion).
+	* weights are in 1/ARA_SCALE, so that the keys are integers */
+	template <typename Board>
+	void arastar(const State&, const Heuristic::Function heuristic, const Heuristic::Context&, Budget::Meter&,
+		const Improvement&, Result&) const;
+	static const int ARA_SCALE = 10, ARA_WEIGHT = 30, ARA_STEP = 5;
+	// stores a solution (moves applied to the root in place) in the Result
+	static void trace(const State& root, const std::vector<Move>& path, Result&);
+	/* stores the solution root -> goal of a search tree in the Result.
+	* walks the parent indices once, then turns the transitions into moves */
+	template <typename T>
+	static void extract(const NodeArena<T>& tree, const unsigned int goal, Result& result) {
+		std::vector<unsigned int> chain;
+		for (unsigned int i = goal; i != NodeArena<T>::NONE; i = tree[i].parent) {
+			chain.push_back(i);
+		}
+		result.path = Path(tree[chain.back()].state);
+		for (std::size_t k = chain.size() - 1; k > 0; k--) {
+			const T& node = tree[chain[k - 1]];
+			result.path.add(tree[chain[k]].state, node.trans.first, node.trans.second);
+		}
+		result.found = true;
+	}
+	// level-synchronous parallel breadth first on "threads" threads (see ParallelBFS.cpp)
+	void pbfs(const State&, const unsigned int threads, Budget::Meter&, Result&) const;
+	// hash distributed A* on "threads" worker threads (see HDAStar.cpp)
+	void hdastar(const State&, const Heuristic::Function heuristic, const Heuristic::Context&, unsigned int threads,
+		Budget::Meter&, Result&) const;
 };
\ No newline at end of file
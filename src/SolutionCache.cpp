@@ -0,0 +1,221 @@
+#include "SolutionCache.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <iterator>
+#include <unistd.h>
+
+
+/* FILE FORMAT
+ * 8 byte magic, then one record per solution: the # of moves (2 bytes),
+ * the normalized start state (State::pack) and 6 bytes per move
+ * (label, row, col, width, height, direction) */
+namespace {
+	const char MAGIC[8] = { 'S', 'B', 'P', 'S', 'O', 'L', '1', 0 };
+	const std::size_t MOVE_SIZE = 6;
+	const std::size_t MAX_MOVES = 0xFFFF;
+
+	/* checks a record before SolutionCache::insert replays it: from the
+	 * normalized root on, every move must name a piece of the state it is
+	 * applied to (label, position and size) and be one of its legal moves,
+	 * and the last state must be solved. applyMove does not check its move */
+	bool legal(const Path& path) {
+		State state(path.root);
+		state.normalize();
+		std::vector<Move> moves;
+		for (std::size_t i = 0; i < path.size(); i++) {
+			Move move = path.moves[i];
+			if (move.piece.row >= state.height || move.piece.col >= state.width) return false;
+			// same as insert: the label of the first move is taken from the root
+			if (i == 0) move.piece.label = (signed char) state.at(move.piece.row, move.piece.col);
+			Piece p = state.getPiece(move.piece.label);
+			if (move.piece.label < 2 || p.row != move.piece.row || p.col != move.piece.col
+				|| p.width != move.piece.width || p.height != move.piece.height) {
+				return false;
+			}
+			state.getAllMoves(moves);
+			if (std::none_of(moves.begin(), moves.end(), [&move](const Move& m) {
+				return m.piece.label == move.piece.label && m.dir == move.dir;
+			})) {
+				return false;
+			}
+			state.applyMove(move);
+			state.normalize();
+		}
+		return state.isSolved();
+	}
+}
+
+
+SolutionCache::SolutionCache(const std::size_t capacity) : capacity(capacity) {
+}
+
+
+bool SolutionCache::open(const std::string& path) {
+	std::lock_guard<std::mutex> lock(mutex);
+	file.close();
+	// 1. read the solutions of an existing file
+	std::size_t valid = 0;
+	bool exists = false;
+	{
+		MappedFile mapped;
+		if (mapped.open(path)) {
+			exists = true;
+			const unsigned char* data = mapped.data();
+			if (mapped.size() < sizeof(MAGIC) || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+				return false;
+			}
+			std::size_t pos = valid = sizeof(MAGIC);
+			while (pos + 2 + State::PACKED_SIZE <= mapped.size()) {
+				std::size_t n = data[pos] | (std::size_t) data[pos + 1] << 8;
+				std::size_t end = pos + 2 + State::PACKED_SIZE + n * MOVE_SIZE;
+				Path p;
+				if (end > mapped.size() || !p.root.unpack(data + pos + 2)) break;
+				const unsigned char* m = data + pos + 2 + State::PACKED_SIZE;
+				for (std::size_t i = 0; i < n; i++, m += MOVE_SIZE) {
+					if (m[5] > (unsigned char) Moves::RIGHT) break;
+					p.moves.push_back(Move{ Piece{ (signed char) m[0], m[1], m[2], m[3], m[4] }, (Moves) m[5] });
+				}
+				// a corrupt or foreign record ends the file like a partly written one
+				if (p.size() != n || !legal(p)) break;
+				insert(p);
+				pos = valid = end;
+			}
+		}
+	}
+	// 2. cut off a partly written record, then append from there
+	if (exists && truncate(path.c_str(), (off_t) valid) != 0) {
+		return false;
+	}
+	file.open(path, std::ios::binary | std::ios::app);
+	if (!exists) {
+		file.write(MAGIC, sizeof(MAGIC));
+		file.flush();
+	}
+	return (bool) file;
+}
+
+
+bool SolutionCache::insert(const Path& path) {
+	Solution s;
+	State state(path.root);
+	state.normalize();
+	std::size_t hash = state.hash();
+	auto it = index.find(hash);
+	if (it != index.end() && it->second.solution->states[it->second.offset].equivalent(state)) {
+		return false;
+	}
+	s.states.reserve(path.size() + 1);
+	s.moves.reserve(path.size());
+	s.states.push_back(state);
+	for (std::size_t i = 0; i < path.size(); i++) {
+		Move move = path.moves[i];
+		// the root may not be normalized. the stored moves all refer to normalized states
+		if (i == 0) move.piece.label = (signed char) state.at(move.piece.row, move.piece.col);
+		s.moves.push_back(move);
+		state.applyMove(move);
+		state.normalize();
+		s.states.push_back(state);
+	}
+	solutions.push_front(s);
+	for (std::size_t i = 0; i < s.states.size(); i++) {
+		// a state along several solutions stays with the one that had it first
+		auto added = index.insert(std::make_pair(s.states[i].hash(), Ref{ solutions.begin(), (unsigned int) i, 0 }));
+		Ref& ref = added.first->second;
+		if (!added.second && ref.solution->states[ref.offset].equivalent(s.states[i])) {
+			ref.others++;
+		}
+	}
+	while (index.size() > capacity && solutions.size() > 1) {
+		evict();
+	}
+	return true;
+}
+
+
+void SolutionCache::evict() {
+	std::list<Solution>::iterator last = std::prev(solutions.end());
+	for (const State& state : last->states) {
+		auto it = index.find(state.hash());
+		if (it == index.end()) continue;
+		Ref& ref = it->second;
+		if (ref.solution != last) {
+			// one of the others
+			if (ref.others > 0 && ref.solution->states[ref.offset].equivalent(state)) ref.others--;
+			continue;
+		}
+		if (ref.others == 0) {
+			index.erase(it);
+			continue;
+		}
+		// hand the state over to another solution along it (rare: the solutions meet)
+		bool moved = false;
+		for (auto sol = solutions.begin(); sol != last && !moved; ++sol) {
+			for (std::size_t i = 0; i < sol->states.size(); i++) {
+				if (!sol->states[i].equivalent(state)) continue;
+				ref = Ref{ sol, (unsigned int) i, ref.others - 1 };
+				moved = true;
+				break;
+			}
+		}
+		if (!moved) index.erase(it);
+	}
+	solutions.erase(last);
+}
+
+
+bool SolutionCache::find(const State& state, Path& path) {
+	std::size_t hash = state.hash();
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = index.find(hash);
+	if (it == index.end()) {
+		return false;
+	}
+	const Ref& ref = it->second;
+	if (!ref.solution->states[ref.offset].equivalent(state)) {
+		return false;
+	}
+	// most recently used
+	solutions.splice(solutions.begin(), solutions, ref.solution);
+	path = Path(state);
+	path.moves.assign(ref.solution->moves.begin() + ref.offset, ref.solution->moves.end());
+	// relabel the first move to the state as it was asked for
+	if (!path.moves.empty()) {
+		Move& first = path.moves[0];
+		first.piece.label = (signed char) state.at(first.piece.row, first.piece.col);
+	}
+	return true;
+}
+
+
+void SolutionCache::store(const Path& path) {
+	if (path.size() > MAX_MOVES) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!insert(path) || !file.is_open()) {
+		return;
+	}
+	const Solution& s = solutions.front();
+	std::vector<unsigned char> record(2 + State::PACKED_SIZE + s.moves.size() * MOVE_SIZE);
+	record[0] = (unsigned char) (s.moves.size() & 0xFF);
+	record[1] = (unsigned char) (s.moves.size() >> 8);
+	s.states[0].pack(record.data() + 2);
+	unsigned char* m = record.data() + 2 + State::PACKED_SIZE;
+	for (const Move& move : s.moves) {
+		m[0] = (unsigned char) move.piece.label;
+		m[1] = move.piece.row;
+		m[2] = move.piece.col;
+		m[3] = move.piece.width;
+		m[4] = move.piece.height;
+		m[5] = (unsigned char) move.dir;
+		m += MOVE_SIZE;
+	}
+	file.write(reinterpret_cast<const char*>(record.data()), (std::streamsize) record.size());
+	file.flush();
+}
+
+
+std::size_t SolutionCache::size() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return index.size();
+}
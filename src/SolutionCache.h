@@ -0,0 +1,75 @@
+#pragma once
+#include "Path.h"
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <fstream>
+#include <string>
+
+/* Cache of optimal solutions, shared by all searches of a Search instance.
+ * Every suffix of an optimal path is an optimal path itself, so a stored
+ * solution answers all states along it: each of them is indexed by its
+ * canonical hash (State::hash, label independent) and its position in
+ * the solution. A hit returns the rest of the solution right away.
+ *
+ * The moves are stored with the labels of the normalized states. On a hit
+ * the first move is relabeled to the state as it was asked for, so that
+ * the Path follows the usual convention (root as given).
+ *
+ * Solutions live in memory in least recently used order. When more than
+ * "capacity" states are indexed, the least recently used solutions go.
+ * With a file, every stored solution is appended to it as well, and the
+ * file is mapped and read back when it is opened. Thread safe */
+class SolutionCache {
+
+public:
+	// empty cache that indexes at most "capacity" states (at least one solution is kept)
+	SolutionCache(const std::size_t capacity = 1 << 20);
+	// empty destructor (the file is closed by the stream)
+	~SolutionCache() {};
+	SolutionCache(const SolutionCache&) = delete;
+	SolutionCache& operator= (const SolutionCache&) = delete;
+
+
+	/* loads the solutions of a cache file and appends new ones to it.
+	 * a missing file is created. a partly written record at the end (crash)
+	 * is cut off, so is everything from the first record whose moves do not
+	 * replay to a solved board. false if the file cannot be created or is
+	 * not a cache file */
+	bool open(const std::string& path);
+	// looks up a State. true (and the rest of an optimal solution in "path") on a hit
+	bool find(const State&, Path& path);
+	// adds an OPTIMAL solution (and with it all states along it)
+	void store(const Path&);
+	// # of indexed states
+	std::size_t size();
+
+
+private:
+	struct Solution {
+		// normalized states along the path: states[i + 1] = states[i] after moves[i]
+		std::vector<State> states;
+		std::vector<Move> moves;
+	};
+	/* a state: its solution and its position in that solution, and the #
+	 * of other solutions along which it lies too (they take it over) */
+	struct Ref {
+		std::list<Solution>::iterator solution;
+		unsigned int offset;
+		unsigned int others;
+	};
+
+	const std::size_t capacity;
+	// most recently used first
+	std::list<Solution> solutions;
+	// canonical hash -> state
+	std::unordered_map<std::size_t, Ref> index;
+	std::mutex mutex;
+	std::ofstream file;
+
+	// adds a solution (lock held). false if its start state is known already
+	bool insert(const Path&);
+	/* drops the least recently used solution (lock held). its states that
+	 * lie along other solutions stay, indexed to one of those */
+	void evict();
+};
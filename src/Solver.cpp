@@ -0,0 +1,45 @@
+#include "Solver.h"
+#include <climits>
+
+
+SolveResult solve(const State& board, const SolveOptions& options) {
+	SolveResult solved;
+	if (!board.valid()) {
+		solved.status = SolveResult::INVALID_BOARD;
+		return solved;
+	}
+	// a Search only holds its options. one per call, nothing is shared but the cache and the databases
+	const Search search(options.cache, true, options.patterns);
+	Search::Result result = search.run(board, options.algorithm, options.heuristic, options.threads,
+		options.budget, options.improved);
+	solved.status = result.exceeded != Budget::NONE ? SolveResult::BUDGET_EXCEEDED
+		: result.found ? SolveResult::SOLVED : SolveResult::UNSOLVABLE;
+	if (result.found) {
+		solved.moves.swap(result.path.moves);
+		solved.cost = (int) solved.moves.size();
+	}
+	solved.bound = result.bound;
+	solved.nodes = result.nodecount;
+	solved.time = result.time;
+	solved.exceeded = result.exceeded;
+	solved.stats = result.stats;
+	return solved;
+}
+
+
+SolveResult solve(const Matrix& board, const SolveOptions& options) {
+	/* State(Matrix) ends the program on boards that are too large and
+	 * wraps values that do not fit into a signed char */
+	bool fits = board.width > 0 && board.height > 0 && board.width * board.height <= State::MAX_CELLS;
+	for (int i = 0; fits && i < board.height; i++) {
+		for (int j = 0; j < board.width; j++) {
+			if (board.at(i, j) < -1 || board.at(i, j) > SCHAR_MAX) fits = false;
+		}
+	}
+	if (!fits) {
+		SolveResult invalid;
+		invalid.status = SolveResult::INVALID_BOARD;
+		return invalid;
+	}
+	return solve(State(board), options);
+}
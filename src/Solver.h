@@ -0,0 +1,77 @@
+#pragma once
+#include "Search.h"
+#include "Budget.h"
+#include "Stats.h"
+#include <vector>
+
+/* The entry point of the library (libsbp): solve(board, options) -> SolveResult.
+ * solve is reentrant. It does no I/O and keeps nothing between calls, so
+ * any number of threads may call it at the same time, on the same board or
+ * on different ones. The only state the calls share is read-only after
+ * setup or owned by the caller: the kernels selected for the CPU at startup
+ * (Kernels), and the SolutionCache and PatternDatabase::Store, if passed */
+
+// how to solve a board
+struct SolveOptions {
+	Search::Algorithm algorithm;
+	// used by the A* variants only
+	Search::Heuristic::Function heuristic;
+	// threads of the multi-threaded algorithms (HDASTAR, PBFS). 0 = one per hardware thread
+	unsigned int threads;
+	// time, node and memory limits and a cancellation token (see Budget.h)
+	Budget budget;
+	// optional, shared with other calls (see SolutionCache.h). nullptr = none
+	SolutionCache* cache;
+	/* optional, shared with other calls: the pattern databases of the layouts
+	 * (see PatternDatabase::Store). nullptr = each call builds its own */
+	PatternDatabase::Store* patterns;
+	// called with every better solution of ARASTAR, on the calling thread
+	Search::Improvement improved;
+
+	// optimal A* with the Manhatten distance, one thread, no limits
+	SolveOptions(const Search::Algorithm algorithm = Search::ASTAR,
+		const Search::Heuristic::Function heuristic = Search::Heuristic::manhatten,
+		const unsigned int threads = 1, const Budget& budget = Budget())
+		: algorithm(algorithm), heuristic(heuristic), threads(threads), budget(budget), cache(nullptr),
+		patterns(nullptr), improved(nullptr) {};
+};
+
+// what solve found out
+struct SolveResult {
+	/* SOLVED          "moves" lead to a solved board
+	 * UNSOLVABLE      the search ended without a solution
+	 * BUDGET_EXCEEDED the search stopped at a limit of the budget ("exceeded").
+	 *                 ARASTAR may still have a solution
+	 * INVALID_BOARD   not State::valid: empty, too large, padding that is not
+	 *                 wall, cell values below -1, no master brick or a piece
+	 *                 that is not a rectangle. no search ran */
+	enum Status { SOLVED, UNSOLVABLE, BUDGET_EXCEEDED, INVALID_BOARD };
+
+	Status status;
+	// the solution, labels as on the normalized boards along it. empty if there is none
+	std::vector<Move> moves;
+	// # of moves of the solution. -1 if there is none
+	int cost;
+	/* the solution is at most "bound" times as long as a shortest one.
+	 * 1 = optimal, 0 = unknown */
+	double bound;
+	// # of nodes the search explored
+	int nodes;
+	// wall time in s
+	float time;
+	// the limit that stopped the search. NONE: it ran to its end
+	Budget::Exceeded exceeded;
+	// counters and phase timers (zero unless compiled with SBP_STATS)
+	Stats stats;
+
+	SolveResult() : status(UNSOLVABLE), cost(-1), bound(0), nodes(0), time(0), exceeded(Budget::NONE) {};
+
+	const bool solved() const {
+		return cost >= 0;
+	}
+};
+
+// solves a board. see above
+SolveResult solve(const State& board, const SolveOptions& options = SolveOptions());
+// same for a Matrix. boards of more than State::MAX_CELLS cells or values above 127 are INVALID_BOARD
+SolveResult solve(const Matrix& board, const SolveOptions& options = SolveOptions());
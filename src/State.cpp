@@ -0,0 +1,380 @@
+#include "State.h"
+
+
+State::State() : width(0), height(0) {
+	std::memset(cells, 1, MAX_CELLS);
+}
+
+
+State::State(const Matrix& m)
+	: width((unsigned char) m.width), height((unsigned char) m.height) {
+	if (m.width * m.height > MAX_CELLS) {
+		std::cout << "Puzzle of size " << m.width << "x" << m.height
+			<< " is too large. At most " << MAX_CELLS << " cells are supported." << std::endl;
+		std::exit(2);
+	}
+	std::memset(cells, 1, MAX_CELLS);
+	for (int i = 0; i < height; i++) {
+		for (int j = 0; j < width; j++) {
+			at(i, j) = (signed char) m.at(i, j);
+		}
+	}
+}
+
+
+void State::pack(unsigned char* out) const {
+	out[0] = width;
+	out[1] = height;
+	std::memcpy(out + 2, cells, MAX_CELLS);
+}
+
+
+bool State::unpack(const unsigned char* in) {
+	State s;
+	s.width = in[0];
+	s.height = in[1];
+	std::memcpy(s.cells, in + 2, MAX_CELLS);
+	if (!s.valid()) {
+		return false;
+	}
+	*this = s;
+	return true;
+}
+
+
+const bool State::valid() const {
+	const int size = width * height;
+	if (width == 0 || height == 0 || size > MAX_CELLS) {
+		return false;
+	}
+	bool checked[128] = { false };
+	for (int i = 0; i < MAX_CELLS; i++) {
+		const signed char c = cells[i];
+		if (i >= size ? c != 1 : c < -1) return false;
+		if (i >= size || c < 2 || checked[c]) continue;
+		// the first cell of a piece: all of its bounding box, nothing else
+		checked[c] = true;
+		Piece p = getPiece(c);
+		if (Kernels::count(mask(c)) != p.width * p.height) return false;
+	}
+	return checked[2];
+}
+
+
+Matrix State::toMatrix() const {
+	Matrix m(width, height);
+	for (int i = 0; i < height; i++) {
+		for (int j = 0; j < width; j++) {
+			m.at(i, j) = at(i, j);
+		}
+	}
+	return m;
+}
+
+
+const bool State::exitsAtOnce() const {
+	const Piece master = getPiece(2);
+	const std::uint64_t exits = mask(-1), walls = mask(1);
+	for (int i = 0; i + master.height <= height; i++) {
+		for (int j = 0; j + master.width <= width; j++) {
+			const std::uint64_t cells = Kernels::rectangle(width, i, i + master.height, j, j + master.width);
+			if (cells & walls) continue;
+			if ((cells & exits) && (cells & exits) != exits) return false;
+		}
+	}
+	return true;
+}
+
+
+std::vector<std::pair<int, int>> State::getPieceIndices(const int piece) const {
+	std::vector<std::pair<int, int>> indices;
+	indices.reserve((width - 1) * (height - 1));
+	for (int i = 0; i < height; i++) {
+		for (int j = 0; j < width; j++) {
+			if (at(i, j) == piece) { // j=x, i=y coord.
+				/* the first index in the list will always
+				 be the top left cell of the piece*/					 
+				indices.push_back(std::pair<int, int>(j, i));
+			}
+		}
+	}
+	return indices;
+}
+
+
+std::pair<int, int> State::getPieceDim(std::vector<std::pair<int, int>> indices) const {
+	std::pair<int, int> dim(0, 0);
+	int tmpX = -1, tmpY = -1;
+	for (unsigned int i = 0; i < indices.size(); i++) {
+		if (indices[i].first > tmpX) {
+			tmpX = indices[i].first;
+			dim.first++;
+		}
+		if (indices[i].second > tmpY) {
+			tmpY = indices[i].second;
+			dim.second++;
+		}
+	}
+	return dim;
+}
+
+
+int State::getPieces(Piece* pieces) const {
+	// label -> position in the piece table (-1 = not seen yet)
+	signed char slot[128];
+	std::memset(slot, -1, sizeof(slot));
+	int n = 0;
+	int k = 0;
+	// whole board, because the master brick may stand on an exit in the wall
+	for (int i = 0; i < height; i++) {
+		for (int j = 0; j < width; j++, k++) {
+			int v = cells[k];
+			if (v < 2) continue;
+			if (slot[v] < 0) {
+				// first cell of a piece (row by row) is its top left corner
+				slot[v] = (signed char) n;
+				pieces[n].label = (signed char) v;
+				pieces[n].row = (unsigned char) i;
+				pieces[n].col = (unsigned char) j;
+				pieces[n].width = 1;
+				pieces[n].height = 1;
+				n++;
+			}
+			else {
+				Piece& p = pieces[slot[v]];
+				if (j - p.col + 1 > p.width) p.width = (unsigned char) (j - p.col + 1);
+				p.height = (unsigned char) (i - p.row + 1);
+			}
+		}
+	}
+	return n;
+}
+
+
+Piece State::getPiece(const int label) const {
+	Piece p{ (signed char) label, 0, 0, 0, 0 };
+	for (int i = 0; i < height; i++) {
+		for (int j = 0; j < width; j++) {
+			if (at(i, j) != label) continue;
+			if (p.width == 0) {
+				p.row = (unsigned char) i;
+				p.col = (unsigned char) j;
+				p.width = 1;
+			}
+			else if (j - p.col + 1 > p.width) {
+				p.width = (unsigned char) (j - p.col + 1);
+			}
+			p.height = (unsigned char) (i - p.row + 1);
+		}
+	}
+	return p;
+}
+
+
+void State::getAllMoves(std::vector<Move>& moves) const {
+	moves.clear();
+	Piece pieces[MAX_CELLS];
+	int n = getPieces(pieces);
+	for (int k = 0; k < n; k++) {
+		const Piece& p = pieces[k];
+		/* movement is only possible, if the cells where the piece
+		 * would "move to" are all 0. the master brick (2) can also move onto -1.
+		 * walls (1) and other pieces block. Only the master brick can touch the
+		 * array bounds (standing on an exit), the bound checks are for it */
+		bool master = p.label == 2;
+		auto isFree = [master](const int v) { return v == 0 || (master && v < 0); };
+		bool up = p.row > 0, down = p.row + p.height < height;
+		bool left = p.col > 0, right = p.col + p.width < width;
+		for (int c = p.col; c < p.col + p.width; c++) {
+			up = up && isFree(at(p.row - 1, c));
+			down = down && isFree(at(p.row + p.height, c));
+		}
+		for (int r = p.row; r < p.row + p.height; r++) {
+			left = left && isFree(at(r, p.col - 1));
+			right = right && isFree(at(r, p.col + p.width));
+		}
+		if (up) moves.push_back(Move{ p, Moves::UP });
+		if (down) moves.push_back(Move{ p, Moves::DOWN });
+		if (left) moves.push_back(Move{ p, Moves::LEFT });
+		if (right) moves.push_back(Move{ p, Moves::RIGHT });
+	}
+}
+
+
+unsigned long long State::applyMove(const Move& move) {
+	const Piece& p = move.piece;
+	unsigned long long exits = 0;
+	int last; // index of the last row/column of the piece
+	switch (move.dir) {
+	case Moves::UP:
+		last = p.row + p.height - 1;
+		for (int c = p.col; c < p.col + p.width; c++) {
+			exits |= (unsigned long long) (at(p.row - 1, c) < 0) << (c - p.col);
+			at(p.row - 1, c) = p.label;
+			at(last, c) = 0;
+		}
+		break;
+	case Moves::DOWN:
+		for (int c = p.col; c < p.col + p.width; c++) {
+			exits |= (unsigned long long) (at(p.row + p.height, c) < 0) << (c - p.col);
+			at(p.row + p.height, c) = p.label;
+			at(p.row, c) = 0;
+		}
+		break;
+	case Moves::LEFT:
+		last = p.col + p.width - 1;
+		for (int r = p.row; r < p.row + p.height; r++) {
+			exits |= (unsigned long long) (at(r, p.col - 1) < 0) << (r - p.row);
+			at(r, p.col - 1) = p.label;
+			at(r, last) = 0;
+		}
+		break;
+	case Moves::RIGHT:
+		for (int r = p.row; r < p.row + p.height; r++) {
+			exits |= (unsigned long long) (at(r, p.col + p.width) < 0) << (r - p.row);
+			at(r, p.col + p.width) = p.label;
+			at(r, p.col) = 0;
+		}
+		break;
+	}
+	return exits;
+}
+
+
+void State::undoMove(const Move& move, const unsigned long long exits) {
+	// the piece stands one cell further in "dir" now. give the front back..
+	const Piece& p = move.piece;
+	int last;
+	switch (move.dir) {
+	case Moves::UP:
+		last = p.row + p.height - 1;
+		for (int c = p.col; c < p.col + p.width; c++) {
+			at(p.row - 1, c) = (exits >> (c - p.col)) & 1 ? -1 : 0;
+			at(last, c) = p.label; // ..and take the back again
+		}
+		break;
+	case Moves::DOWN:
+		for (int c = p.col; c < p.col + p.width; c++) {
+			at(p.row + p.height, c) = (exits >> (c - p.col)) & 1 ? -1 : 0;
+			at(p.row, c) = p.label;
+		}
+		break;
+	case Moves::LEFT:
+		last = p.col + p.width - 1;
+		for (int r = p.row; r < p.row + p.height; r++) {
+			at(r, p.col - 1) = (exits >> (r - p.row)) & 1 ? -1 : 0;
+			at(r, last) = p.label;
+		}
+		break;
+	case Moves::RIGHT:
+		for (int r = p.row; r < p.row + p.height; r++) {
+			at(r, p.col + p.width) = (exits >> (r - p.row)) & 1 ? -1 : 0;
+			at(r, p.col) = p.label;
+		}
+		break;
+	}
+}
+
+
+void State::applyMove(const int piece, const Moves move) {
+	std::vector<std::pair<int, int>> indices = getPieceIndices(piece);
+	if (indices.empty()) return; // piece not on the board!
+	std::pair<int, int> dim = getPieceDim(indices);
+	Piece p = { (signed char) piece, (unsigned char) indices[0].second,
+		(unsigned char) indices[0].first, (unsigned char) dim.first, (unsigned char) dim.second };
+	applyMove(Move{ p, move });
+}
+
+
+State State::applyMoveCloning(const Move& move) const {
+	State s_clone(*this);
+	s_clone.applyMove(move);
+	return s_clone;
+}
+
+
+void State::normalize() {
+	// label -> new label (0 = not seen yet)
+	signed char remap[128] = { 0 };
+	signed char nextIdx = 3;
+	/* the whole board: pieces may stand on the edge, on exit cells the
+	 * master brick left (they are free cells from then on) */
+	for (std::uint64_t rest = maskAbove(2); rest; rest &= rest - 1) {
+		signed char& c = cells[Kernels::lowest(rest)];
+		if (!remap[c]) {
+			remap[c] = nextIdx++;
+		}
+		c = remap[c];
+	}
+}
+
+
+const std::size_t State::hash() const {
+	std::size_t h = sizeHash(width, height);
+	Piece pieces[MAX_CELLS];
+	int n = getPieces(pieces);
+	for (int k = 0; k < n; k++) {
+		h ^= pieceHash(pieces[k].row * width + pieces[k].col, pieces[k]);
+	}
+	for (std::uint64_t exits = mask(-1); exits; exits &= exits - 1) {
+		h ^= exitHash(Kernels::lowest(exits));
+	}
+	return h;
+}
+
+
+const std::size_t State::moveHash(const std::size_t h, const Move& move) const {
+	Piece p = move.piece;
+	std::size_t next = h ^ pieceHash(p.row * width + p.col, p);
+	// first cell and step of the row/column the piece moves onto
+	int first = 0, step = 0, n = 0;
+	switch (move.dir) {
+	case Moves::UP:
+		first = (p.row - 1) * width + p.col; step = 1; n = p.width; p.row--; break;
+	case Moves::DOWN:
+		first = (p.row + p.height) * width + p.col; step = 1; n = p.width; p.row++; break;
+	case Moves::LEFT:
+		first = p.row * width + p.col - 1; step = width; n = p.height; p.col--; break;
+	case Moves::RIGHT:
+		first = p.row * width + p.col + p.width; step = width; n = p.height; p.col++; break;
+	}
+	// exits the master brick moves onto are gone for good
+	for (int k = 0, idx = first; k < n; k++, idx += step) {
+		if (cells[idx] == -1) next ^= exitHash(idx);
+	}
+	return next ^ pieceHash(p.row * width + p.col, p);
+}
+
+
+const bool State::equivalent(const State& other) const {
+	if (width != other.width || height != other.height) {
+		return false;
+	}
+	const std::uint64_t all = Kernels::first(MAX_CELLS);
+	const std::uint64_t same = Kernels::compare(cells, other.cells, MAX_CELLS);
+	if (same == all) {
+		return true;
+	}
+	// exits, empty cells, walls and the master (<= 2) must match exactly
+	const std::uint64_t pieces = Kernels::greaterThan(cells, MAX_CELLS, 2)
+		& Kernels::greaterThan(other.cells, MAX_CELLS, 2);
+	if (~pieces & ~same & all) {
+		return false;
+	}
+	// label mapping in both directions must stay a bijection
+	signed char fwd[128] = { 0 };
+	signed char bwd[128] = { 0 };
+	for (std::uint64_t rest = pieces; rest; rest &= rest - 1) {
+		int i = Kernels::lowest(rest);
+		signed char a = cells[i];
+		signed char b = other.cells[i];
+		if (!fwd[a] && !bwd[b]) {
+			fwd[a] = b;
+			bwd[b] = a;
+		}
+		else if (fwd[a] != b || bwd[b] != a) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include "Matrix.h"
+#include "Kernels.h"
+#include <cstring>
+
+/* a piece (brick) on the board. pieces are rectangles, so the
+ * top left corner and the dimensions describe all of its cells */
+struct Piece {
+	signed char label;
+	unsigned char row, col, width, height;
+};
+
+/* a move of a piece in one direction. Carries the piece position,
+ * so that applying it only touches the cells that change */
+struct Move {
+	Piece piece;
+	Moves dir;
+};
+
+/* Compact, allocation free puzzle state used by the search algorithms.
+ * The cells are stored inline, one byte per cell (walls included), so that
+ * copying a state is a plain 64 byte memcpy. Matrix remains the class to
+ * load, print and edit puzzles. It converts to and from State.
+ * Unused cells at the end of the array are always 1 (wall), which lets
+ * hashing and comparison work on the whole array. */
+class State {
+
+public:
+	// max # of cells (width * height, walls included). 62 + 2 bytes = 64 bytes
+	static const int MAX_CELLS = 62;
+	// size of the packed image of a State (see pack)
+	static const int PACKED_SIZE = MAX_CELLS + 2;
+
+
+	// empty state (0 x 0)
+	State();
+	// packs a Matrix. exits if the Matrix does not fit into MAX_CELLS
+	explicit State(const Matrix&);
+	// default copy constructor & assign operator (memcpy)
+
+
+	// member variables. board dimensions, walls included
+	unsigned char width, height;
+
+
+	// unpacks the state into a Matrix (for printing)
+	Matrix toMatrix() const;
+	/* writes the packed image (PACKED_SIZE bytes): width, height, then the
+	 * cells row by row, padded with walls. the record format of Corpus files */
+	void pack(unsigned char*) const;
+	/* reads a packed image. returns false (and leaves the State unchanged)
+	 * if it is not a valid board (see valid) */
+	bool unpack(const unsigned char*);
+	/* checks a board from outside (width, height and cells are public):
+	 * 1 to MAX_CELLS cells, padding that is wall, no cell value below -1,
+	 * a master brick and every piece a filled rectangle */
+	const bool valid() const;
+	// value of the cell at row, col
+	inline int at(const int row, const int col) const {
+		return cells[row * width + col];
+	}
+	// reference to the cell at row, col
+	inline signed char& at(const int row, const int col) {
+		return cells[row * width + col];
+	}
+	// check if puzzle is completed (no exit cell -1 left)
+	inline const bool isSolved() const {
+		return Kernels::equalTo(cells, MAX_CELLS, -1) == 0;
+	}
+	// bit mask of the cells with a value (bit row * width + col, see Kernels)
+	inline std::uint64_t mask(const signed char value) const {
+		return Kernels::equalTo(cells, MAX_CELLS, value);
+	}
+	// bit mask of the cells with a value greater than "value"
+	inline std::uint64_t maskAbove(const signed char value) const {
+		return Kernels::greaterThan(cells, MAX_CELLS, value);
+	}
+	// collects indices of a piece. First one is always upper left corner
+	std::vector<std::pair<int, int>> getPieceIndices(const int) const;
+	// calculates the piece dimensions. first: width, second: height
+	std::pair<int, int> getPieceDim(std::vector<std::pair<int, int>>) const;
+	/* fills the piece table in one pass over the board. pieces are ordered
+	 * by their top left corner (row by row). returns the # of pieces.
+	 * "pieces" must hold at least MAX_CELLS entries */
+	int getPieces(Piece*) const;
+	// position and size of a single piece. width and height are 0 if it is not on the board
+	Piece getPiece(const int) const;
+	/* true if the master brick covers either all exit cells (-1) or none,
+	 * wherever it stands off the walls. Then every move can be undone until
+	 * the board is solved. Otherwise it can cover a part of the exit, which
+	 * turns those cells into free ones (0) for good: the moves onto them
+	 * cannot be undone (State::isSolved waits for the last exit cell) */
+	const bool exitsAtOnce() const;
+	/* collects all legal moves of all pieces into "moves" (cleared first)
+	 * in piece table order and UP, DOWN, LEFT, RIGHT per piece */
+	void getAllMoves(std::vector<Move>& moves) const;
+	/* applies a move. only the cells at the front and back of the piece change.
+	 * returns a mask of the front cells that were exits (-1), for undoMove */
+	unsigned long long applyMove(const Move&);
+	// reverts applyMove. "exits" is the mask applyMove returned
+	void undoMove(const Move&, const unsigned long long exits);
+	// applies a move to a piece. Does NOT check wheather the move is valid!
+	void applyMove(const int, const Moves);
+	// copies the current State, applies a move and returns the new State
+	State applyMoveCloning(const Move&) const;
+	/* normalizes the State row by row, top to bottom, edges included. one pass:
+	 * every label > 2 is renamed in order of its first appearance */
+	void normalize();
+	/* canonical hash, computed from the piece table: one term per piece
+	 * (position, size, master or not) and per exit cell (-1), combined with XOR.
+	 * labels other than the master are irrelevant, thus a State and its
+	 * normalized copy have the same hash */
+	const std::size_t hash() const;
+	// hash of the State after "move", given the hash of this State. O(piece size)
+	const std::size_t moveHash(const std::size_t, const Move&) const;
+	/* checks if two States are equal after normalization, without normalizing.
+	 * equal States have the same pieces at the same positions */
+	const bool equivalent(const State&) const;
+
+
+	/***  overloaded operators   ***/
+
+	// outputs the State in the same format as Matrix
+	friend inline std::ostream& operator<<(
+		std::ostream& os, State const& s) {
+		os << (int) s.width << "," << (int) s.height << "," << std::endl;
+		for (int i = 0; i < s.height; i++) {
+			for (int j = 0; j < s.width; j++) {
+				os << s.at(i, j) << ",";
+			}
+			os << std::endl;
+		}
+		return os;
+	}
+
+	// compares two States for equality (dimensions are part of the array)
+	inline bool operator==(State const& other) const {
+		return width == other.width && height == other.height &&
+			Kernels::compare(cells, other.cells, MAX_CELLS) == Kernels::first(MAX_CELLS);
+	}
+	inline bool operator!=(State const& other) const {
+		return !(*this == other);
+	}
+
+
+private:
+	// contents of the board, row by row
+	signed char cells[MAX_CELLS];
+	// 64 bit finalizer (splitmix64). spreads small keys over all bits
+	static inline std::size_t mix(unsigned long long x) {
+		x += 0x9E3779B97F4A7C15ULL;
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+		return (std::size_t) (x ^ (x >> 31));
+	}
+	// hash term of the board dimensions
+	static inline std::size_t sizeHash(const int width, const int height) {
+		return mix((unsigned long long) width << 8 | height);
+	}
+	// hash term of a piece whose top left corner is at a cell index
+	static inline std::size_t pieceHash(const int corner, const Piece& p) {
+		return mix((unsigned long long) corner
+			| (unsigned long long) p.width << 8
+			| (unsigned long long) p.height << 16
+			| (unsigned long long) (p.label == 2) << 24);
+	}
+	// hash term of an exit cell (-1) at a cell index
+	static inline std::size_t exitHash(const int idx) {
+		return mix((unsigned long long) idx | 1ULL << 32);
+	}
+
+	// the board operations for fixed board sizes work on the cells directly
+	template <int W, int H> friend struct FixedBoard;
+
+};
@@ -0,0 +1,133 @@
+#pragma once
+#include "State.h"
+#include <vector>
+#include <cstddef>
+#include <type_traits>
+
+/* the value of a StateMap slot. an empty value type takes no space in the
+ * slot (empty base), so that a StateSet (StateMap of nothing) stays small */
+template <typename V, bool = std::is_empty<V>::value>
+struct StateMapValue {
+	V value;
+
+	V& get() { return value; }
+	const V& get() const { return value; }
+};
+template <typename V>
+struct StateMapValue<V, true> : V {
+	V& get() { return *this; }
+	const V& get() const { return *this; }
+};
+
+/* Open-addressing hash map from puzzle states to values.
+ * Linear probing with the load factor kept below 1/2. States are compared
+ * with State::equivalent, thus a State that is not normalized finds its
+ * normalized copy. Every State carries a value of type V (StateSet: none).
+ * Only pointers to the States are stored. The States are owned by the
+ * caller and must outlive the map! */
+template <typename V>
+class StateMap {
+
+public:
+	// creates an empty map. capacity is rounded up to a power of 2
+	StateMap(const std::size_t capacity = 1024) : count(0) {
+		std::size_t size = 16;
+		while (size < capacity) size <<= 1;
+		slots.assign(size, Slot());
+		mask = size - 1;
+	}
+
+
+	/* returns a pointer to the value of an equal state, or nullptr.
+	 * the pointer is valid until the next insert */
+	V* find(const State& state, const std::size_t hash) {
+		Slot& s = slots[index(state, hash)];
+		return s.state ? &s.get() : nullptr;
+	}
+	const V* find(const State& state, const std::size_t hash) const {
+		const Slot& s = slots[index(state, hash)];
+		return s.state ? &s.get() : nullptr;
+	}
+	/* inserts a state with its value. if an equal state is already in the map
+	 * nothing changes and false is returned */
+	bool insert(const State* state, const std::size_t hash, const V& value) {
+		// keep the load factor below 1/2, so probe sequences stay short
+		if ((count + 1) * 2 > slots.size()) {
+			grow();
+		}
+		Slot& s = slots[index(*state, hash)];
+		if (s.state) {
+			return false;
+		}
+		s.hash = hash;
+		s.state = state;
+		s.get() = value;
+		count++;
+		return true;
+	}
+	// # of states in the map
+	const std::size_t size() const {
+		return count;
+	}
+	// memory held by the table (the states are not part of it)
+	const std::size_t bytes() const {
+		return slots.size() * sizeof(Slot);
+	}
+	// calls f(const State&, V&) for every entry
+	template <typename F>
+	void forEach(F f) {
+		for (Slot& s : slots) {
+			if (s.state) f(*s.state, s.get());
+		}
+	}
+	// removes all states, keeps the allocated table
+	void clear() {
+		for (Slot& s : slots) {
+			s.state = nullptr;
+		}
+		count = 0;
+	}
+
+
+private:
+	// one cell of the table. an empty slot has state == nullptr
+	struct Slot : StateMapValue<V> {
+		std::size_t hash;
+		const State* state;
+
+		Slot() : StateMapValue<V>(), hash(0), state(nullptr) {};
+	};
+	std::vector<Slot> slots;
+	std::size_t count;
+	// slots.size() - 1. slots.size() is always a power of 2
+	std::size_t mask;
+
+
+	// returns the slot index of the state or of the empty slot where it belongs
+	std::size_t index(const State& state, const std::size_t hash) const {
+		std::size_t idx = hash & mask;
+		while (slots[idx].state) {
+			if (slots[idx].hash == hash && slots[idx].state->equivalent(state)) {
+				return idx;
+			}
+			idx = (idx + 1) & mask;
+		}
+		return idx;
+	}
+	// doubles the table size and rehashes all states
+	void grow() {
+		std::vector<Slot> old;
+		old.swap(slots);
+		slots.assign(old.size() * 2, Slot());
+		mask = slots.size() - 1;
+		for (const Slot& s : old) {
+			if (s.state) {
+				std::size_t idx = s.hash & mask;
+				while (slots[idx].state) {
+					idx = (idx + 1) & mask;
+				}
+				slots[idx] = s;
+			}
+		}
+	}
+};
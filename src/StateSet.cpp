@@ -0,0 +1,40 @@
+#include "StateSet.h"
+
+
+StateSet::StateSet(const std::size_t capacity) : map(capacity) {
+}
+
+
+bool StateSet::insert(const State* m) {
+	return insert(m, m->hash());
+}
+
+
+bool StateSet::insert(const State* m, const std::size_t hash) {
+	return map.insert(m, hash, None());
+}
+
+
+const bool StateSet::contains(const State& m) const {
+	return contains(m, m.hash());
+}
+
+
+const bool StateSet::contains(const State& m, const std::size_t hash) const {
+	return map.find(m, hash) != nullptr;
+}
+
+
+const std::size_t StateSet::size() const {
+	return map.size();
+}
+
+
+const std::size_t StateSet::bytes() const {
+	return map.bytes();
+}
+
+
+void StateSet::clear() {
+	map.clear();
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "State.h"
+#include "StateMap.h"
+#include <cstddef>
+
+/* Open-addressing hash set of puzzle states.
+ * Used by the search algorithms as "visited" container, so that a lookup
+ * costs O(1) instead of a linear scan over all visited nodes.
+ * A StateMap without values (see there for the scheme): States are
+ * compared with State::equivalent, thus a State that is not normalized
+ * finds its normalized copy in the set.
+ * The set only stores pointers to the states. The states themselves
+ * are owned by the search (nodes) and must outlive the set! */
+class StateSet {
+
+public:
+	// creates an empty set. capacity is rounded up to a power of 2
+	StateSet(const std::size_t capacity = 1024);
+	// empty destructor
+	~StateSet() {};
+
+
+	// inserts a state. returns false if an equal state is already in the set
+	bool insert(const State*);
+	// same, with a precomputed State::hash (e.g. from State::moveHash)
+	bool insert(const State*, const std::size_t hash);
+	// checks if an equal state is in the set
+	const bool contains(const State&) const;
+	// same, with a precomputed State::hash
+	const bool contains(const State&, const std::size_t hash) const;
+	// # of states in the set
+	const std::size_t size() const;
+	// memory held by the table (the states are not part of it)
+	const std::size_t bytes() const;
+	// removes all states, keeps the allocated table
+	void clear();
+
+
+private:
+	// no value. takes no space in the slots of the map
+	struct None {};
+	StateMap<None> map;
+};
@@ -0,0 +1,114 @@
+#include "StateSpace.h"
+#include "StateMap.h"
+#include <deque>
+#include <memory>
+
+
+namespace {
+	const char MAGIC[8] = { 'S', 'B', 'P', 'S', 'P', 'C', '1', 0 };
+}
+
+
+const std::uint16_t StateSpace::UNSOLVABLE;
+
+
+StateSpace::StateSpace(const State& start, const Budget& budget) : header(), stoppedBy(Budget::NONE) {
+	Budget::Meter meter(budget);
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.start = start;
+	header.start.normalize();
+	// 1. enumerate. states[i] has the children next[offsets[i]..offsets[i+1])
+	std::deque<State> states;
+	StateMap<unsigned int> index(1024);
+	std::vector<unsigned int> offsets(1, 0), next;
+	std::vector<Move> moves;
+	states.push_back(header.start);
+	index.insert(&states.back(), states.back().hash(), 0);
+	for (std::size_t i = 0; i < states.size(); i++) {
+		if (meter.exceeded(states.size(), [&]() {
+			return states.size() * sizeof(State) + index.bytes() + (offsets.capacity() + next.capacity()) * sizeof(unsigned int);
+		})) {
+			// nothing of a partial enumeration is kept
+			stoppedBy = meter.exceededBy();
+			return;
+		}
+		const State& state = states[i];
+		if (!state.isSolved()) {
+			std::size_t hash = state.hash();
+			state.getAllMoves(moves);
+			for (const Move& move : moves) {
+				std::size_t childHash = state.moveHash(hash, move);
+				State child = state.applyMoveCloning(move);
+				const unsigned int* j = index.find(child, childHash);
+				if (j) {
+					next.push_back(*j);
+					continue;
+				}
+				child.normalize();
+				states.push_back(child);
+				index.insert(&states.back(), childHash, (unsigned int) (states.size() - 1));
+				next.push_back((unsigned int) (states.size() - 1));
+			}
+		}
+		offsets.push_back((unsigned int) next.size());
+	}
+	std::size_t n = states.size();
+	// 2. reverse the edges (counting sort by target)
+	std::vector<unsigned int> reverseOffsets(n + 1, 0), previous(next.size());
+	for (unsigned int j : next) reverseOffsets[j + 1]++;
+	for (std::size_t i = 0; i < n; i++) reverseOffsets[i + 1] += reverseOffsets[i];
+	std::vector<unsigned int> fill(reverseOffsets.begin(), reverseOffsets.end() - 1);
+	for (std::size_t i = 0; i < n; i++) {
+		for (unsigned int e = offsets[i]; e < offsets[i + 1]; e++) {
+			previous[fill[next[e]]++] = (unsigned int) i;
+		}
+	}
+	// 3. breadth first search from all solved states at once, against the edges
+	std::vector<std::uint16_t> dist(n, UNSOLVABLE);
+	std::vector<unsigned int> queue;
+	for (std::size_t i = 0; i < n; i++) {
+		if (states[i].isSolved()) {
+			dist[i] = 0;
+			queue.push_back((unsigned int) i);
+		}
+	}
+	header.solved = queue.size();
+	for (std::size_t q = 0; q < queue.size(); q++) {
+		unsigned int i = queue[q];
+		for (unsigned int e = reverseOffsets[i]; e < reverseOffsets[i + 1]; e++) {
+			unsigned int j = previous[e];
+			if (dist[j] != UNSOLVABLE) continue;
+			dist[j] = dist[i] + 1;
+			header.maxDistance = dist[j];
+			queue.push_back(j);
+		}
+	}
+	header.states = n;
+	header.unsolvable = n - queue.size();
+	header.edges = next.size();
+	// 4. fill the table
+	table.reserve(n, UNSOLVABLE);
+	for (std::size_t i = 0; i < n; i++) {
+		table.insert(DistanceTable<std::uint16_t>::key(states[i].hash()), dist[i]);
+	}
+}
+
+
+StateSpace* StateSpace::load(const std::string& path) {
+	std::unique_ptr<StateSpace> space(new StateSpace());
+	if (!space->table.load(path, MAGIC, &space->header, sizeof(Header))) {
+		return nullptr;
+	}
+	return space.release();
+}
+
+
+bool StateSpace::save(const std::string& path) const {
+	return table.save(path, &header, sizeof(Header));
+}
+
+
+const int StateSpace::distance(const State& s) const {
+	std::uint16_t d = table.find(DistanceTable<std::uint16_t>::key(s.hash()), UNSOLVABLE);
+	return d == UNSOLVABLE ? -1 : d;
+}
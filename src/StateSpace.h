@@ -0,0 +1,94 @@
+#pragma once
+#include "State.h"
+#include "DistanceTable.h"
+#include "Budget.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/* The whole reachable state space of a level and the exact distance to
+ * the goal of every state in it.
+ *
+ * Enumerating is a breadth first search over the normalized states
+ * (State::getAllMoves, State::normalize). The edges are kept in compressed
+ * sparse row form: the children of state i are next[offsets[i]..offsets[i+1]).
+ * Solved states are not expanded, like in every other search. A second
+ * breadth first search runs over the reversed edges from all solved states
+ * at once and yields the optimal # of moves to solve from every state.
+ *
+ * The result is a compact table: canonical hash (State::hash) -> distance
+ * (see DistanceTable.h). States are identified by their 64 bit hash
+ * alone. A lookup is a single probe sequence, no search.
+ * The table can be saved and loaded (memory mapped, no copy).
+ * Enumerating is limited by a Budget like a search (nodes: the states
+ * enumerated, bytes: the states, the edges and the index). A StateSpace
+ * it stopped is empty and tells why (exceeded) */
+class StateSpace {
+
+public:
+	// distance of states that cannot reach a solved state
+	static const std::uint16_t UNSOLVABLE = 0xFFFF;
+
+
+	// enumerates all states reachable from "start"
+	explicit StateSpace(const State& start, const Budget& budget = Budget());
+	// empty destructor (the mapping, if any, is released by the table)
+	~StateSpace() {};
+	StateSpace(const StateSpace&) = delete;
+	StateSpace& operator= (const StateSpace&) = delete;
+
+
+	/* maps a table file. returns nullptr if it cannot be read or is
+	 * not a valid table. the caller owns the object */
+	static StateSpace* load(const std::string& path);
+	// writes the table to a file. false on error
+	bool save(const std::string& path) const;
+	/* optimal # of moves to solve a State of this level. -1 if the State
+	 * was not reached from the start, or no solved state can be reached from it */
+	const int distance(const State&) const;
+	// the start state (normalized)
+	const State& start() const {
+		return header.start;
+	}
+	// # of reachable states
+	std::uint64_t states() const {
+		return header.states;
+	}
+	// # of reachable solved states
+	std::uint64_t solved() const {
+		return header.solved;
+	}
+	// # of reachable states that cannot be solved
+	std::uint64_t unsolvable() const {
+		return header.unsolvable;
+	}
+	// # of edges (moves between reachable states)
+	std::uint64_t edges() const {
+		return header.edges;
+	}
+	// largest distance of a solvable state
+	int maxDistance() const {
+		return (int) header.maxDistance;
+	}
+	// the limit of the Budget that stopped the enumeration. NONE: it is complete
+	Budget::Exceeded exceeded() const {
+		return stoppedBy;
+	}
+
+
+private:
+	// file header, followed by the table
+	struct Header {
+		char magic[8];
+		State start;
+		std::uint64_t states, solved, unsolvable, edges;
+		std::uint32_t maxDistance, pad;
+	};
+	static_assert(sizeof(Header) % 8 == 0, "the table must start 8 byte aligned");
+
+	Header header;
+	DistanceTable<std::uint16_t> table;
+	Budget::Exceeded stoppedBy;
+
+	StateSpace() : header(), stoppedBy(Budget::NONE) {};
+};
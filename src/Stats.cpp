@@ -0,0 +1,59 @@
+#include "Stats.h"
+#include <algorithm>
+
+
+Stats::Stats()
+	: generated(0), duplicates(0), expanded(0), peakOpen(0), peakClosed(0), totalNs(0) {
+	std::fill(phaseNs, phaseNs + PHASES, 0);
+	std::fill(branching, branching + BRANCHING, 0);
+}
+
+
+void Stats::merge(const Stats& other) {
+	generated += other.generated;
+	duplicates += other.duplicates;
+	expanded += other.expanded;
+	peakOpen += other.peakOpen;
+	peakClosed += other.peakClosed;
+	for (int i = 0; i < PHASES; i++) {
+		phaseNs[i] += other.phaseNs[i];
+	}
+	for (int i = 0; i < BRANCHING; i++) {
+		branching[i] += other.branching[i];
+	}
+}
+
+
+const char* Stats::phaseName(const Phase phase) {
+	switch (phase) {
+	case MOVEGEN: return "movegen";
+	case NORMALIZE: return "normalize";
+	case HASH: return "hash";
+	case HEURISTIC: return "heuristic";
+	case QUEUE: return "queue";
+	default: return "unknown";
+	}
+}
+
+
+void Stats::writeJSON(std::ostream& os) const {
+	os << "{\"enabled\": " << (enabled ? "true" : "false")
+		<< ", \"total_ns\": " << totalNs
+		<< ", \"generated\": " << generated
+		<< ", \"duplicates\": " << duplicates
+		<< ", \"expanded\": " << expanded
+		<< ", \"peak_open\": " << peakOpen
+		<< ", \"peak_closed\": " << peakClosed
+		<< ", \"phase_ns\": {";
+	for (int i = 0; i < PHASES; i++) {
+		os << (i ? ", " : "") << "\"" << phaseName((Phase) i) << "\": " << phaseNs[i];
+	}
+	// histogram without the trailing empty buckets
+	int last = BRANCHING;
+	while (last > 0 && branching[last - 1] == 0) last--;
+	os << "}, \"branching\": [";
+	for (int i = 0; i < last; i++) {
+		os << (i ? ", " : "") << branching[i];
+	}
+	os << "]}";
+}
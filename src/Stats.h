@@ -0,0 +1,81 @@
+#pragma once
+#include <chrono>
+#include <ostream>
+
+/* Optional instrumentation of the search algorithms.
+ * Compiled in with -DSBP_STATS (cmake -DSBP_STATS=ON). Otherwise the
+ * STATS and STATS_TIMED macros expand to nothing (resp. the bare
+ * expression) and the hot paths carry no extra code at all.
+ * Every Result holds a Stats, which stays zero when compiled out */
+struct Stats {
+	// true if the instrumentation is compiled in
+#ifdef SBP_STATS
+	static const bool enabled = true;
+#else
+	static const bool enabled = false;
+#endif
+
+	// phases of a search with a cumulative timer each
+	enum Phase { MOVEGEN, NORMALIZE, HASH, HEURISTIC, QUEUE, PHASES };
+	// branching factor histogram buckets. the last one counts all >= BRANCHING - 1
+	static const int BRANCHING = 32;
+
+	/* successors produced by move generation, successors dropped because
+	 * their state was already known, nodes whose successors were generated */
+	unsigned long long generated, duplicates, expanded;
+	// largest size of the open list (queue, stack, path) and of the closed set
+	unsigned long long peakOpen, peakClosed;
+	// time spent per phase in ns
+	unsigned long long phaseNs[PHASES];
+	// branching[k] = # of expansions with k legal moves
+	unsigned long long branching[BRANCHING];
+	// wall time of the whole run in ns (always measured)
+	unsigned long long totalNs;
+
+	Stats();
+
+	// records one expansion with "moves" successors
+	inline void expand(const unsigned long long moves) {
+		expanded++;
+		generated += moves;
+		branching[moves < BRANCHING ? moves : BRANCHING - 1]++;
+	}
+	inline void open(const unsigned long long size) {
+		if (size > peakOpen) peakOpen = size;
+	}
+	inline void closed(const unsigned long long size) {
+		if (size > peakClosed) peakClosed = size;
+	}
+	// adds the counters of another search (e.g. of a worker thread). peaks add up, too
+	void merge(const Stats&);
+	// name of a phase as used in the JSON output
+	static const char* phaseName(const Phase);
+	// writes the stats as a single JSON object
+	void writeJSON(std::ostream&) const;
+
+	// adds the time between construction and destruction to a phase
+	class Timer {
+	public:
+		Timer(Stats& stats, const Phase phase)
+			: stats(stats), phase(phase), start(std::chrono::steady_clock::now()) {};
+		~Timer() {
+			stats.phaseNs[phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count();
+		}
+	private:
+		Stats& stats;
+		const Phase phase;
+		const std::chrono::steady_clock::time_point start;
+	};
+};
+
+/* STATS(statement) runs the statement only if the stats are compiled in.
+ * STATS_TIMED(stats, phase, expression) evaluates the expression and
+ * adds the time it took to the phase */
+#ifdef SBP_STATS
+#define STATS(...) __VA_ARGS__
+#define STATS_TIMED(stats, phase, ...) ([&]() { Stats::Timer statsTimer((stats), Stats::phase); return __VA_ARGS__; }())
+#else
+#define STATS(...)
+#define STATS_TIMED(stats, phase, ...) (__VA_ARGS__)
+#endif
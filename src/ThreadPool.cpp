@@ -0,0 +1,123 @@
+#include "ThreadPool.h"
+
+
+namespace {
+	// index of the worker running on this thread (-1 = not a worker)
+	thread_local int workerIndex = -1;
+	// pool the worker belongs to
+	thread_local const ThreadPool* workerPool = nullptr;
+}
+
+
+ThreadPool::ThreadPool(unsigned int threads) : next(0), pending(0), stop(false) {
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+		if (threads == 0) threads = 1;
+	}
+	for (unsigned int i = 0; i < threads; i++) {
+		queues.push_back(std::unique_ptr<Queue>(new Queue()));
+	}
+	for (unsigned int i = 0; i < threads; i++) {
+		workers.push_back(std::thread(&ThreadPool::work, this, i));
+	}
+}
+
+
+ThreadPool::~ThreadPool() {
+	wait();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	cv.notify_all();
+	for (std::thread& t : workers) {
+		t.join();
+	}
+}
+
+
+void ThreadPool::submit(std::function<void()> task) {
+	unsigned int idx;
+	if (workerPool == this) {
+		idx = workerIndex;
+	}
+	else {
+		idx = next++ % queues.size();
+	}
+	pending++;
+	{
+		std::lock_guard<std::mutex> lock(queues[idx]->mutex);
+		queues[idx]->tasks.push_back(std::move(task));
+	}
+	// take the pool lock, so a worker going to sleep can't miss the notification
+	std::lock_guard<std::mutex> lock(mutex);
+	cv.notify_one();
+}
+
+
+void ThreadPool::wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this]() { return pending == 0; });
+}
+
+
+const unsigned int ThreadPool::size() const {
+	return (unsigned int) workers.size();
+}
+
+
+void ThreadPool::work(const unsigned int idx) {
+	workerIndex = idx;
+	workerPool = this;
+	std::function<void()> task;
+	while (true) {
+		if (take(idx, task)) {
+			task();
+			task = nullptr;
+			if (--pending == 0) {
+				std::lock_guard<std::mutex> lock(mutex);
+				done.notify_all();
+			}
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		if (stop) return;
+		// recheck under the lock: submit() notifies while holding it
+		bool empty = true;
+		for (auto& q : queues) {
+			std::lock_guard<std::mutex> qlock(q->mutex);
+			if (!q->tasks.empty()) {
+				empty = false;
+				break;
+			}
+		}
+		if (empty) {
+			cv.wait(lock);
+		}
+	}
+}
+
+
+bool ThreadPool::take(const unsigned int idx, std::function<void()>& task) {
+	// own queue first (back)..
+	{
+		Queue& q = *queues[idx];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if (!q.tasks.empty()) {
+			task = std::move(q.tasks.back());
+			q.tasks.pop_back();
+			return true;
+		}
+	}
+	// ..then steal from the others (front)
+	for (unsigned int i = 1; i < queues.size(); i++) {
+		Queue& q = *queues[(idx + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if (!q.tasks.empty()) {
+			task = std::move(q.tasks.front());
+			q.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
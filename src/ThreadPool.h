@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+/* Work-stealing thread pool.
+ * Every worker owns a task queue. A worker takes tasks from the back of
+ * its own queue (LIFO, cache friendly) and, once it runs dry, steals from
+ * the front of the other queues (FIFO, oldest = usually biggest task).
+ * Tasks submitted from outside the pool are spread round robin, tasks
+ * submitted from inside a worker go to that worker's own queue. */
+class ThreadPool {
+
+public:
+	// starts the worker threads. 0 = one per hardware thread
+	ThreadPool(unsigned int threads = 0);
+	// waits for all submitted tasks, then joins the workers
+	~ThreadPool();
+
+
+	// adds a task to the pool
+	void submit(std::function<void()>);
+	// blocks until all submitted tasks (including the ones they submit) are done
+	void wait();
+	// # of worker threads
+	const unsigned int size() const;
+
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+	// round robin index for tasks submitted from outside
+	std::atomic<unsigned int> next;
+	// # of tasks submitted but not finished yet
+	std::atomic<unsigned int> pending;
+	// sleeping workers block on "cv", wait() blocks on "done"
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::condition_variable done;
+	bool stop;
+
+
+	// main loop of a worker thread
+	void work(const unsigned int);
+	// takes a task from the own queue or steals one. false if all queues are empty
+	bool take(const unsigned int, std::function<void()>&);
+};
@@ -0,0 +1,33 @@
+#include "TranspositionTable.h"
+
+
+TranspositionTable::TranspositionTable(const unsigned int bits)
+	: entries(std::size_t(1) << bits, Entry{ 0, 0, 0, 0 }), mask((std::size_t(1) << bits) - 1), iteration(1) {
+}
+
+
+void TranspositionTable::nextIteration() {
+	iteration++;
+}
+
+
+bool TranspositionTable::seen(const std::size_t hash, const std::uint32_t check, const int depthLeft) {
+	Entry& e = entries[hash & mask];
+	if (e.iteration == iteration && e.hash == hash && e.check == check && e.depthLeft >= depthLeft) {
+		return true;
+	}
+	e.hash = hash;
+	e.check = check;
+	e.depthLeft = depthLeft;
+	e.iteration = iteration;
+	return false;
+}
+
+
+std::uint32_t TranspositionTable::check(const State& board) {
+	// multiply-xorshift over the occupied, master and exit cells. no Zobrist terms
+	std::uint64_t x = board.maskAbove(2) * 0x9E3779B97F4A7C15ULL ^ board.mask(2);
+	x = (x ^ (x >> 29)) * 0xBF58476D1CE4E5B9ULL ^ board.mask(-1);
+	x = (x ^ (x >> 32)) * 0x94D049BB133111EBULL;
+	return (std::uint32_t) (x >> 32);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "State.h"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/* Fixed-size, lossy transposition table for depth first searches.
+ * Remembers how much search depth was left below a state (depth limit - g,
+ * or f-bound - g for IDA*) when it was searched in the current iteration.
+ * One entry per slot, a new state simply overwrites the old one, so
+ * memory never grows. Losing an entry only costs a re-search. A false
+ * match prunes a subtree that was never searched, so a state must match
+ * both its 64 bit State::hash and a 32 bit check word taken from the
+ * board's occupancy (check). Results are optimal up to collisions of both */
+class TranspositionTable {
+
+public:
+	// allocates 2^bits entries (24 bytes each)
+	TranspositionTable(const unsigned int bits = 20);
+	// empty destructor
+	~TranspositionTable() {};
+
+
+	// starts a new iteration. entries of older iterations count as empty
+	void nextIteration();
+	/* true if the state was already searched with at least "depthLeft"
+	 * in this iteration, i.e. the subtree can be skipped.
+	 * Otherwise records depthLeft for the state and returns false */
+	bool seen(const std::size_t hash, const std::uint32_t check, const int depthLeft);
+	// check word of a board, independent of the piece terms of State::hash
+	static std::uint32_t check(const State& board);
+	// memory held by the table (fixed)
+	const std::size_t bytes() const {
+		return entries.size() * sizeof(Entry);
+	}
+
+
+private:
+	struct Entry {
+		std::size_t hash;
+		std::uint32_t check;
+		int depthLeft;
+		unsigned int iteration;
+	};
+	std::vector<Entry> entries;
+	std::size_t mask;
+	// starts at 1. iteration 0 marks empty entries
+	unsigned int iteration;
+};
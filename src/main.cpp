@@ -1,8 +1,280 @@
 #include "Search.h"
+#include "Batch.h"
+#include "StateSpace.h"
+#include "Options.h"
+#include <fstream>
+#include <sstream>
+#include <climits>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 
-int main() {
+
+/* batch mode: solve many levels with many configurations in parallel
+ *   sbp --batch <directory|glob> [--threads N] [--search-threads N] [--config name,name,..]
+ *       [--pdb-dir directory] [--cache file] [--out file]
+ *       [--time-limit s] [--node-limit N] [--memory-limit bytes]
+ * --config defaults to all configurations (see Batch::allConfigs)
+ * --search-threads is the # of threads of multi-threaded algorithms (hdastar), default 1
+ * --pdb-dir keeps the pattern databases (*-pattern configurations) in a directory across runs
+ * --cache keeps the optimal solutions in a file and answers states along them without a search
+ * --time-limit, --node-limit and --memory-limit stop each job at that budget (see Budget.h).
+ *   its status is then "time exceeded", "nodes exceeded" or "memory exceeded"
+ * --batch also takes a corpus file (see Corpus.h), made from level files by
+ *   sbp --convert <directory|glob> --out file */
+int runBatch(int argc, char* argv[]) {
+	string levelPath, outPath, convertPath, cachePath, pdbPath;
+	unsigned int threads = 0, searchThreads = 1;
+	Budget budget;
+	bool valid;
+	vector<Batch::Config> configs;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (i + 1 >= argc) {
+			cout << "Missing value for '" << arg << "'" << endl;
+			return 1;
+		}
+		string value = argv[++i];
+		if (arg == "--batch") {
+			levelPath = value;
+		}
+		else if (arg == "--cache") {
+			cachePath = value;
+		}
+		else if (arg == "--convert") {
+			convertPath = value;
+		}
+		else if (arg == "--threads" || arg == "--search-threads") {
+			unsigned long long n;
+			if (!Options::parseCount(value, UINT_MAX, n)) return Options::invalidValue(arg, value);
+			(arg == "--threads" ? threads : searchThreads) = (unsigned int) n;
+		}
+		else if (Options::budgetOption(arg, value, budget, valid)) {
+			if (!valid) return Options::invalidValue(arg, value);
+		}
+		else if (arg == "--out") {
+			outPath = value;
+		}
+		else if (arg == "--pdb-dir") {
+			// the databases are saved there quietly. tell now if they cannot be
+			struct stat info;
+			if (stat(value.c_str(), &info) != 0 || !S_ISDIR(info.st_mode) || access(value.c_str(), W_OK) != 0) {
+				cout << "Warning. Cannot save pattern databases to '" << value << "'" << endl;
+			}
+			pdbPath = value;
+		}
+		else if (arg == "--config") {
+			stringstream ss(value);
+			string name;
+			while (getline(ss, name, ',')) {
+				Batch::Config c;
+				if (!Batch::findConfig(name, c)) {
+					cout << "Unknown configuration '" << name << "'" << endl;
+					return 1;
+				}
+				configs.push_back(c);
+			}
+		}
+		else {
+			cout << "Unknown argument '" << arg << "'" << endl;
+			return 1;
+		}
+	}
+	if (!convertPath.empty()) {
+		vector<string> levels = Batch::findLevels(convertPath);
+		if (levels.empty() || outPath.empty()) {
+			cout << (levels.empty() ? "No level files found for '" + convertPath + "'" : "Missing --out file") << endl;
+			return 1;
+		}
+		string failed;
+		Corpus::Error e = Corpus::convert(levels, outPath, &failed);
+		if (e != Corpus::OK) {
+			cout << "Converting failed: " << Corpus::message(e) << (failed.empty() ? "" : " '" + failed + "'") << endl;
+			return 1;
+		}
+		cout << levels.size() << " levels written to '" << outPath << "'" << endl;
+		return 0;
+	}
+	if (configs.empty()) {
+		configs = Batch::allConfigs();
+	}
+	SolutionCache cache;
+	if (!cachePath.empty() && !cache.open(cachePath)) {
+		cout << "Cannot open solution cache '" << cachePath << "'" << endl;
+		return 1;
+	}
+	// the pattern databases of all jobs, built once per layout
+	PatternDatabase::Store patterns(64, pdbPath);
+	Batch batch(threads, searchThreads, cachePath.empty() ? nullptr : &cache, budget, &patterns);
+	vector<Batch::Job> jobs;
+	// a corpus file, or else level text files
+	Corpus corpus;
+	Corpus::Error e = corpus.open(levelPath);
+	if (e == Corpus::OK) {
+		jobs = batch.run(levelPath, corpus, configs);
+	}
+	else if (e == Corpus::BAD_SIZE) {
+		cout << "Corpus '" << levelPath << "': " << Corpus::message(e) << endl;
+		return 1;
+	}
+	else {
+		vector<string> levels = Batch::findLevels(levelPath);
+		if (levels.empty()) {
+			cout << "No level files found for '" << levelPath << "'" << endl;
+			return 1;
+		}
+		jobs = batch.run(levels, configs);
+	}
+	if (outPath.empty()) {
+		Batch::write(cout, jobs);
+	}
+	else {
+		ofstream out(outPath);
+		Batch::write(out, jobs);
+	}
+	return 0;
+}
+
+
+/* layer mode: # of states per depth of a breadth first search
+ *   sbp --layers <level> [--all] [--threads N] [--external directory] [--memory N]
+ *       [--time-limit s] [--node-limit N] [--memory-limit bytes]
+ * --all counts the whole reachable state space instead of stopping at the goal
+ * --external keeps the layers in files in that directory (ExternalBFS.cpp),
+ * with at most --memory states in memory (default 1048576)
+ * the limits stop the count (see Budget.h). the complete layers are printed */
+int runLayers(int argc, char* argv[]) {
+	string level = argv[2], directory;
+	bool all = false, valid;
+	Budget budget;
+	unsigned int threads = 0;
+	size_t memory = 1 << 20;
+	for (int i = 3; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--all") {
+			all = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			cout << "Missing value for '" << arg << "'" << endl;
+			return 1;
+		}
+		string value = argv[++i];
+		if (arg == "--threads") {
+			unsigned long long n;
+			if (!Options::parseCount(value, UINT_MAX, n)) return Options::invalidValue(arg, value);
+			threads = (unsigned int) n;
+		}
+		else if (arg == "--external") {
+			directory = value;
+		}
+		else if (arg == "--memory") {
+			unsigned long long n;
+			if (!Options::parseCount(value, SIZE_MAX, n)) return Options::invalidValue(arg, value);
+			memory = (size_t) n;
+		}
+		else if (Options::budgetOption(arg, value, budget, valid)) {
+			if (!valid) return Options::invalidValue(arg, value);
+		}
+		else {
+			cout << "Unknown argument '" << arg << "'" << endl;
+			return 1;
+		}
+	}
+	State board;
+	Corpus::Error e = Corpus::readLevel(level, board);
+	if (e != Corpus::OK) {
+		cout << "Level '" << level << "': " << Corpus::message(e) << endl;
+		return 1;
+	}
+	Search search;
+	Search::LayerCount count;
+	if (directory.empty()) {
+		count = search.countLayers(board.toMatrix(), !all, threads, budget);
+	}
+	else if (!search.countLayersExternal(board.toMatrix(), directory, count, memory, !all, budget)) {
+		cout << "Cannot write the layer files to '" << directory << "'" << endl;
+		return 1;
+	}
+	size_t total = 0;
+	for (size_t d = 0; d < count.layers.size(); d++) {
+		cout << "depth " << d << ": " << count.layers[d] << endl;
+		total += count.layers[d];
+	}
+	cout << "#states: " << total << "  max depth: " << count.layers.size() - 1
+		<< "  solution depth: " << count.depth << "  time: " << count.time << "s" << endl;
+	if (count.exceeded != Budget::NONE) {
+		cout << "Budget exceeded (" << Budget::name(count.exceeded) << "). The count is incomplete" << endl;
+		return 1;
+	}
+	return 0;
+}
+
+
+/* enumeration mode: the whole reachable state space of a level
+ *   sbp --enumerate <level> [--out file] [--time-limit s] [--node-limit N] [--memory-limit bytes]
+ * prints the # of states, solved states, edges and the distances to the goal.
+ * --out saves the distance table (StateSpace.h). the limits stop the enumeration */
+int runEnumerate(int argc, char* argv[]) {
+	string level = argv[2], outPath;
+	Budget budget;
+	bool valid;
+	for (int i = 3; i < argc; i++) {
+		string arg = argv[i];
+		if (i + 1 >= argc) {
+			cout << "Missing value for '" << arg << "'" << endl;
+			return 1;
+		}
+		string value = argv[++i];
+		if (arg == "--out") {
+			outPath = value;
+		}
+		else if (Options::budgetOption(arg, value, budget, valid)) {
+			if (!valid) return Options::invalidValue(arg, value);
+		}
+		else {
+			cout << "Unknown argument '" << arg << "'" << endl;
+			return 1;
+		}
+	}
+	State board;
+	Corpus::Error e = Corpus::readLevel(level, board);
+	if (e != Corpus::OK) {
+		cout << "Level '" << level << "': " << Corpus::message(e) << endl;
+		return 1;
+	}
+	auto start = chrono::high_resolution_clock::now();
+	StateSpace space(board, budget);
+	auto end = chrono::high_resolution_clock::now();
+	if (space.exceeded() != Budget::NONE) {
+		cout << "Budget exceeded (" << Budget::name(space.exceeded()) << ") after "
+			<< chrono::duration_cast<chrono::milliseconds>(end - start).count() / 1000.0 << "s. No state space" << endl;
+		return 1;
+	}
+	cout << "#states: " << space.states() << "  solved: " << space.solved()
+		<< "  unsolvable: " << space.unsolvable() << "  edges: " << space.edges() << endl;
+	cout << "start distance: " << space.distance(board) << "  max distance: " << space.maxDistance()
+		<< "  time: " << chrono::duration_cast<chrono::milliseconds>(end - start).count() / 1000.0 << "s" << endl;
+	if (!outPath.empty() && !space.save(outPath)) {
+		cout << "Could not write '" << outPath << "'" << endl;
+		return 1;
+	}
+	return 0;
+}
+
+
+int main(int argc, char* argv[]) {
+	if (argc > 2 && string(argv[1]) == "--layers") {
+		return runLayers(argc, argv);
+	}
+	if (argc > 2 && string(argv[1]) == "--enumerate") {
+		return runEnumerate(argc, argv);
+	}
+	if (argc > 1) {
+		return runBatch(argc, argv);
+	}
+
 	Search search;
 	// run the first 2 level (0,1)
 	for (int i = 0; i < 2; i++) {
@@ -15,28 +287,23 @@ int main() {
 
 		// Breadth first
 		cout << "BFS" << endl;
-		search.run(m, Search::Algorithm::BFS);
-		search.printResults();
+		search.printResults(search.run(m, Search::Algorithm::BFS));
 
 		// Depth first
 		cout << "DFS" << endl;
-		search.run(m, Search::Algorithm::DFS);
-		search.printResults();
+		search.printResults(search.run(m, Search::Algorithm::DFS));
 
 		// Iterative Deepening
 		cout << "IDDFS" << endl;
-		search.run(m, Search::Algorithm::IDDFS);
-		search.printResults();
+		search.printResults(search.run(m, Search::Algorithm::IDDFS));
 
 		// A* with Manhattan distance as heuristic
 		cout << "A* manhatten" << endl;
-		search.run(m, Search::Algorithm::ASTAR, Search::Heuristic::manhatten);
-		search.printResults();
+		search.printResults(search.run(m, Search::Algorithm::ASTAR, Search::Heuristic::manhatten));
 
 		// A* with Blocking cells as heuristic
 		cout << "A* blocking" << endl;
-		search.run(m, Search::Algorithm::ASTAR, Search::Heuristic::blocking);
-		search.printResults();
+		search.printResults(search.run(m, Search::Algorithm::ASTAR, Search::Heuristic::blocking));
 
 		cout << endl;
 	}
@@ -0,0 +1,145 @@
+#include "Batch.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/* the thread pool and the batch mode on top of it
+ *   BatchTest <level directory>
+ * the pool runs every task submitted from several threads at once and from
+ * inside its tasks, and wait() returns once they are done. Batch finds
+ * its configurations by name and the levels of a directory or glob, and
+ * writes one CSV row per job (a node budget keeps the big levels short,
+ * a missing file fails its jobs). returns 1 if anything fails */
+
+namespace {
+	bool fail(const string& what) {
+		cout << what << endl;
+		return false;
+	}
+
+	bool testPool() {
+		const unsigned int SUBMITTERS = 4, TASKS = 2000;
+		ThreadPool pool(3);
+		atomic<unsigned int> ran(0);
+		// every task of the submitters adds a child task from inside the pool
+		vector<thread> submitters;
+		for (unsigned int t = 0; t < SUBMITTERS; t++) {
+			submitters.emplace_back([&]() {
+				for (unsigned int i = 0; i < TASKS; i++) {
+					pool.submit([&]() {
+						ran++;
+						pool.submit([&]() { ran++; });
+					});
+				}
+			});
+		}
+		for (thread& t : submitters) {
+			t.join();
+		}
+		pool.wait();
+		bool ok = true;
+		if (ran != 2 * SUBMITTERS * TASKS) {
+			ok = fail("pool: " + to_string(ran.load()) + " of " + to_string(2 * SUBMITTERS * TASKS) + " tasks ran");
+		}
+		// an idle pool returns at once and takes new tasks
+		pool.wait();
+		pool.submit([&]() { ran++; });
+		pool.wait();
+		if (ran != 2 * SUBMITTERS * TASKS + 1) ok = fail("pool: no task runs after wait()");
+		return ok;
+	}
+
+	bool testConfigs() {
+		bool ok = true;
+		for (const Batch::Config& c : Batch::allConfigs()) {
+			Batch::Config found;
+			if (!Batch::findConfig(c.name, found) || found.algorithm != c.algorithm || found.heuristic != c.heuristic) {
+				ok = fail("config '" + c.name + "' is not found by its name");
+			}
+		}
+		Batch::Config c;
+		if (!Batch::findConfig("astar-blocking", c) || c.algorithm != Search::ASTAR
+			|| c.heuristic != Search::Heuristic::blocking) {
+			ok = fail("config 'astar-blocking' is not A* with the blocking heuristic");
+		}
+		if (Batch::findConfig("astar", c) || Batch::findConfig("", c)) ok = fail("unknown config found");
+		return ok;
+	}
+
+	bool testLevels(const string& directory) {
+		bool ok = true;
+		vector<string> all = Batch::findLevels(directory);
+		if (all.size() != 11 || all.front() != directory + "/level0.txt") {
+			ok = fail("levels: " + to_string(all.size()) + " levels in " + directory);
+		}
+		// level1 and level10
+		vector<string> glob = Batch::findLevels(directory + "/level1*.txt");
+		if (glob.size() != 2 || glob[0] != directory + "/level1.txt" || glob[1] != directory + "/level10.txt") {
+			ok = fail("levels: the glob level1*.txt finds " + to_string(glob.size()) + " levels");
+		}
+		if (!Batch::findLevels(directory + "/none*.txt").empty()) ok = fail("levels: a glob without match finds levels");
+		return ok;
+	}
+
+	bool testRun(const string& directory) {
+		vector<Batch::Config> configs(2);
+		Batch::findConfig("bfs", configs[0]);
+		Batch::findConfig("astar-manhatten", configs[1]);
+		vector<string> levels = Batch::findLevels(directory);
+		levels.push_back(directory + "/missing.txt");
+		Batch batch(0, 1, nullptr, Budget(0, 20000));
+		vector<Batch::Job> jobs = batch.run(levels, configs);
+		if (jobs.size() != levels.size() * configs.size()) {
+			return fail("batch: " + to_string(jobs.size()) + " jobs for "
+				+ to_string(levels.size()) + " levels x " + to_string(configs.size()) + " configs");
+		}
+		stringstream csv;
+		Batch::write(csv, jobs);
+		string line;
+		getline(csv, line);
+		if (line != "level,config,nodes,time,length,status") return fail("batch: CSV header '" + line + "'");
+		bool ok = true;
+		size_t rows = 0;
+		while (getline(csv, line)) {
+			if (rows >= jobs.size()) {
+				ok = fail("batch: CSV row without job: " + line);
+				break;
+			}
+			const Batch::Job& job = jobs[rows++];
+			// the job order is level by level, each with every config
+			const string& level = levels[(rows - 1) / configs.size()];
+			const string& config = configs[(rows - 1) % configs.size()].name;
+			if (line.compare(0, level.size() + config.size() + 2, level + "," + config + ",") != 0) {
+				ok = fail("batch: expected " + level + " " + config + ", got " + line);
+			}
+			string status = line.substr(line.rfind(',') + 1);
+			if (level == directory + "/missing.txt") {
+				if (job.error == Corpus::OK || status != Corpus::message(job.error)) {
+					ok = fail("batch: the missing level did not fail: " + line);
+				}
+			}
+			else if (status == "done" ? job.result.length() < 0 : status != "nodes exceeded") {
+				ok = fail("batch: " + line);
+			}
+		}
+		if (rows != jobs.size()) ok = fail("batch: " + to_string(rows) + " CSV rows for " + to_string(jobs.size()) + " jobs");
+		return ok;
+	}
+}
+
+
+int main(int argc, char* argv[]) {
+	string directory = argc > 1 ? argv[1] : "level";
+	bool ok = testPool();
+	ok = testConfigs() && ok;
+	ok = testLevels(directory) && ok;
+	ok = testRun(directory) && ok;
+	cout << (ok ? "pool and batch work" : "FAILED") << endl;
+	return ok ? 0 : 1;
+}
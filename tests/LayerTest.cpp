@@ -0,0 +1,136 @@
+#include "Search.h"
+#include "StateSpace.h"
+#include "Corpus.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <numeric>
+
+using namespace std;
+
+/* the three ways to walk a whole state space must agree
+ *   LayerTest <level directory> <temporary directory>
+ * per level: the layer sizes of the parallel BFS (countLayers) and of the
+ * external BFS (countLayersExternal, small buffer so that it merges runs)
+ * are equal, and so are the # of states and the distance of the start in
+ * StateSpace. The same for both BFS on a board whose exit the
+ * master brick covers cell by cell (older states come back in later
+ * layers there). All three must stop at a node and a memory budget,
+ * keeping only complete layers. returns 1 if anything fails */
+
+namespace {
+	// levels with small state spaces (a second each at most)
+	const int LEVELS[] = { 0, 1, 2, 3, 4, 8, 10 };
+
+	bool fail(const string& what) {
+		cout << what << endl;
+		return false;
+	}
+
+	bool testLevel(const string& path, const string& temporary) {
+		State board;
+		if (Corpus::readLevel(path, board) != Corpus::OK) return fail(path + ": cannot read the level");
+		Search search;
+		// the whole space, and up to the goal
+		Search::LayerCount all = search.countLayers(board.toMatrix(), false, 2);
+		Search::LayerCount toGoal = search.countLayers(board.toMatrix(), true, 2);
+		Search::LayerCount external;
+		if (!search.countLayersExternal(board.toMatrix(), temporary, external, 1000, false)) {
+			return fail(path + ": cannot write the layer files");
+		}
+		bool ok = true;
+		if (all.layers != external.layers || all.depth != external.depth) {
+			ok = fail(path + ": parallel and external layers differ");
+		}
+		if (all.depth != toGoal.depth || toGoal.depth != (int) toGoal.layers.size() - 1) {
+			ok = fail(path + ": the solution depth depends on stopping at the goal");
+		}
+		StateSpace space(board);
+		size_t states = accumulate(all.layers.begin(), all.layers.end(), (size_t) 0);
+		if (space.states() != states) {
+			ok = fail(path + ": the state space has " + to_string(space.states())
+				+ " states, the layers " + to_string(states));
+		}
+		else if (space.distance(board) != all.depth) {
+			ok = fail(path + ": the start distance differs from the solution depth");
+		}
+		return ok;
+	}
+
+	// an exit of three cells and a 1x1 master
+	bool testWideExit(const string& temporary) {
+		const int rows[5][6] = {
+			{ 1, -1, -1, -1, 1, 1 },
+			{ 1, 3, 2, 4, 0, 1 },
+			{ 1, 0, 5, 5, 0, 1 },
+			{ 1, 0, 0, 0, 0, 1 },
+			{ 1, 1, 1, 1, 1, 1 },
+		};
+		State board;
+		board.width = 6;
+		board.height = 5;
+		for (int i = 0; i < board.height; i++) {
+			for (int j = 0; j < board.width; j++) board.at(i, j) = (signed char) rows[i][j];
+		}
+		Search::LayerCount all = Search().countLayers(board.toMatrix(), false, 2);
+		Search::LayerCount external;
+		if (!Search().countLayersExternal(board.toMatrix(), temporary, external, 1000, false)) {
+			return fail("wide exit: cannot write the layer files");
+		}
+		if (all.layers != external.layers) return fail("wide exit: parallel and external layers differ");
+		StateSpace space(board);
+		size_t states = accumulate(all.layers.begin(), all.layers.end(), (size_t) 0);
+		if (space.states() != states) {
+			return fail("wide exit: the state space has " + to_string(space.states())
+				+ " states, the layers " + to_string(states));
+		}
+		if (space.distance(board) != all.depth) return fail("wide exit: the start distance differs from the solution depth");
+		return true;
+	}
+
+	// budgets that stop all three before the end of the state space of a level
+	bool testBudget(const string& path, const string& temporary) {
+		State board;
+		if (Corpus::readLevel(path, board) != Corpus::OK) return fail(path + ": cannot read the level");
+		Search::LayerCount full = Search().countLayers(board.toMatrix(), false, 2);
+		const Budget budgets[] = { Budget(0, 1000), Budget(0, 0, 1000) };
+		const Budget::Exceeded expected[] = { Budget::NODES, Budget::MEMORY };
+		bool ok = true;
+		for (int i = 0; i < 2; i++) {
+			string name = path + " " + Budget::name(expected[i]) + " budget: ";
+			Search::LayerCount counts[2];
+			counts[0] = Search().countLayers(board.toMatrix(), false, 2, budgets[i]);
+			if (!Search().countLayersExternal(board.toMatrix(), temporary, counts[1], 100, false, budgets[i])) {
+				return fail(name + "cannot write the layer files");
+			}
+			for (const Search::LayerCount& count : counts) {
+				if (count.exceeded != expected[i]) {
+					ok = fail(name + Budget::name(count.exceeded) + " exceeded instead");
+				}
+				else if (count.layers.size() >= full.layers.size()
+					|| !equal(count.layers.begin(), count.layers.end(), full.layers.begin())) {
+					ok = fail(name + "the layers up to the stop differ");
+				}
+			}
+			StateSpace space(board, budgets[i]);
+			if (space.exceeded() != expected[i] || space.states() != 0 || space.distance(board) != -1) {
+				ok = fail(name + "the state space does not stop empty");
+			}
+		}
+		return ok;
+	}
+}
+
+
+int main(int argc, char* argv[]) {
+	string directory = argc > 1 ? argv[1] : "level";
+	string temporary = argc > 2 ? argv[2] : ".";
+	bool ok = true;
+	for (int i : LEVELS) {
+		ok = testLevel(directory + "/level" + to_string(i) + ".txt", temporary) && ok;
+	}
+	ok = testWideExit(temporary) && ok;
+	ok = testBudget(directory + "/level8.txt", temporary) && ok;
+	cout << (ok ? "layer counts agree" : "FAILED") << endl;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,439 @@
+#include "Search.h"
+#include "Solver.h"
+#include "Corpus.h"
+#include "SolutionCache.h"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/* Search::run with every algorithm on the bundled levels
+ *   SolveTest <level directory> <temporary directory>
+ * every solution must replay to a solved board, the optimal algorithms must
+ * find the shortest one. IDDFS and IDA* only run on the smaller levels.
+ * The same on a board whose exit the master brick covers one cell at a time.
+ * ARA* must report solutions that get no longer and bounds that get no
+ * larger. Every algorithm must stop without a solution at a node budget,
+ * a memory budget and a cancellation. solve() must give the same solutions
+ * when called from many threads at once, sharing a bounded store of pattern
+ * databases. The SolutionCache must answer the states along its solutions,
+ * drop the least recently used ones and read its file back. solve() must
+ * turn down boards that are not valid. returns 1 if anything fails */
+
+namespace {
+	// optimal # of moves of level0..level10
+	const int LENGTHS[] = { 5, 16, 12, 50, 28, 47, 46, 57, 47, 65, 117 };
+	const int LEVELS = 11;
+	// levels the iterative deepening searches run on (they take seconds on the others)
+	const int DEEPENING_LEVELS = 7;
+
+	struct Config {
+		string name;
+		Search::Algorithm algorithm;
+		Search::Heuristic::Function heuristic;
+		bool optimal;
+		bool deepening;
+	};
+
+	vector<Config> configs() {
+		Search::Heuristic::Function manhatten = Search::Heuristic::manhatten;
+		Search::Heuristic::Function blocking = Search::Heuristic::blocking;
+		Search::Heuristic::Function pattern = Search::Heuristic::pattern;
+		return vector<Config>{
+			{ "bfs", Search::BFS, manhatten, true, false },
+			{ "pbfs", Search::PBFS, manhatten, true, false },
+			{ "dfs", Search::DFS, manhatten, false, false },
+			{ "iddfs", Search::IDDFS, manhatten, true, true },
+			{ "astar-manhatten", Search::ASTAR, manhatten, true, false },
+			{ "astar-blocking", Search::ASTAR, blocking, false, false },
+			{ "astar-pattern", Search::ASTAR, pattern, true, false },
+			{ "astar-buckets-manhatten", Search::ASTAR_BUCKETS, manhatten, true, false },
+			{ "astar-buckets-pattern", Search::ASTAR_BUCKETS, pattern, true, false },
+			{ "idastar-manhatten", Search::IDASTAR, manhatten, true, true },
+			{ "idastar-pattern", Search::IDASTAR, pattern, true, true },
+			{ "hdastar-manhatten", Search::HDASTAR, manhatten, true, false },
+			{ "hdastar-pattern", Search::HDASTAR, pattern, true, false },
+			{ "arastar-manhatten", Search::ARASTAR, manhatten, true, false },
+			{ "arastar-pattern", Search::ARASTAR, pattern, true, false },
+		};
+	}
+
+	/* replays a solution (State::applyMove, State::normalize). true if every
+	 * move names a piece of the board it is applied to (label, position and
+	 * size) and the last board is solved */
+	bool replays(const State& board, const vector<Move>& moves) {
+		State s(board);
+		for (const Move& move : moves) {
+			Piece p = s.getPiece(move.piece.label);
+			if (p.row != move.piece.row || p.col != move.piece.col
+				|| p.width != move.piece.width || p.height != move.piece.height) {
+				return false;
+			}
+			s.applyMove(move);
+			s.normalize();
+		}
+		return s.isSolved();
+	}
+
+	bool fail(const string& what) {
+		cout << what << endl;
+		return false;
+	}
+
+	// every configuration on a board with a shortest solution of "length" moves
+	bool testBoard(const string& path, const State& board, const int length, const bool deepening) {
+		// the *-pattern configurations share the database of the board
+		PatternDatabase::Store patterns;
+		Search search(nullptr, true, &patterns);
+		bool ok = true;
+		for (const Config& c : configs()) {
+			if (c.deepening && !deepening) continue;
+			Search::Result r = search.run(board, c.algorithm, c.heuristic, 2);
+			string name = path + " " + c.name + ": ";
+			if (!r.solved()) {
+				ok = fail(name + "not solved");
+			}
+			else if (!replays(board, r.path.moves)) {
+				ok = fail(name + "the solution does not replay");
+			}
+			else if (c.optimal && r.length() != length) {
+				ok = fail(name + to_string(r.length()) + " moves instead of " + to_string(length));
+			}
+			else if (!c.optimal && r.length() < length) {
+				ok = fail(name + "shorter than optimal");
+			}
+		}
+		return ok;
+	}
+
+	bool testLevel(const string& path, const int level) {
+		State board;
+		if (Corpus::readLevel(path, board) != Corpus::OK) return fail(path + ": cannot read the level");
+		return testBoard(path, board, LENGTHS[level], level < DEEPENING_LEVELS);
+	}
+
+	// a board from its rows
+	State board(const vector<vector<int>>& rows) {
+		State s;
+		s.width = (unsigned char) rows[0].size();
+		s.height = (unsigned char) rows.size();
+		for (int i = 0; i < s.height; i++) {
+			for (int j = 0; j < s.width; j++) s.at(i, j) = (signed char) rows[i][j];
+		}
+		return s;
+	}
+
+	/* an exit of three cells and a 1x1 master: it covers them one by one
+	 * (up, then along the top edge), each cell is free once it left it */
+	bool testWideExit() {
+		State wide = board({
+			{ 1, -1, -1, -1, 1, 1 },
+			{ 1, 3, 2, 4, 0, 1 },
+			{ 1, 0, 5, 5, 0, 1 },
+			{ 1, 0, 0, 0, 0, 1 },
+			{ 1, 1, 1, 1, 1, 1 },
+		});
+		return testBoard("wide exit", wide, 4, true);
+	}
+
+	/* a 1x2 master that covers one of two exits at a time. Once it used up
+	 * the right one (up) and stands below the left one, one move is left:
+	 * the pattern database of the start must not tell more */
+	bool testExitsOneByOne() {
+		State start = board({
+			{ 0, -1, -1, 0, 1, 1 },
+			{ 0, 0, 2, 2, 0, 1 },
+			{ 0, 0, 0, 0, 3, 1 },
+		});
+		State oneLeft = board({
+			{ 0, -1, 0, 0, 1, 1 },
+			{ 2, 2, 0, 0, 0, 1 },
+			{ 0, 0, 0, 0, 3, 1 },
+		});
+		bool ok = testBoard("exits one by one", start, 2, true);
+		ok = testBoard("exits one by one, one left", oneLeft, 1, true) && ok;
+		unique_ptr<PatternDatabase> patterns(PatternDatabase::build(start));
+		if (patterns && patterns->distance(oneLeft) > 1) ok = fail("exits one by one pattern: overestimates");
+		return ok;
+	}
+
+	// the improvements of ARA* on a level, and a budget too small to solve it
+	bool testAnytime(const string& path, const int level) {
+		State board;
+		if (Corpus::readLevel(path, board) != Corpus::OK) return fail(path + ": cannot read the level");
+		Search search;
+		vector<Search::Result> improvements;
+		Search::Result r = search.run(board, Search::ARASTAR, Search::Heuristic::manhatten, 0, Budget(),
+			[&improvements](const Search::Result& r) { improvements.push_back(r); });
+		string name = path + " arastar: ";
+		if (improvements.empty()) return fail(name + "no improvements reported");
+		for (size_t i = 1; i < improvements.size(); i++) {
+			const Search::Result& a = improvements[i - 1];
+			const Search::Result& b = improvements[i];
+			if (b.length() > a.length() || b.bound > a.bound || b.bound < 1) {
+				return fail(name + "improvement " + to_string(i) + " is not better");
+			}
+		}
+		if (r.bound != 1 || improvements.back().bound != 1 || r.length() != LENGTHS[level]) {
+			return fail(name + "the last solution is not optimal");
+		}
+		Search::Result limited = search.run(board, Search::ARASTAR, Search::Heuristic::manhatten, 0,
+			Budget(0, 100));
+		if (limited.solved() || limited.nodecount > 200) {
+			return fail(name + "does not stop at the node budget");
+		}
+		return true;
+	}
+
+	// budgets too small to solve a level, and a search cancelled before it starts
+	bool testBudget(const string& path) {
+		State board;
+		if (Corpus::readLevel(path, board) != Corpus::OK) return fail(path + ": cannot read the level");
+		Search search;
+		const atomic<bool> cancel(true);
+		const Budget budgets[] = { Budget(0, 100), Budget(0, 0, 1), Budget(0, 0, 0, &cancel) };
+		const Budget::Exceeded expected[] = { Budget::NODES, Budget::MEMORY, Budget::CANCELLED };
+		bool ok = true;
+		for (const Config& c : configs()) {
+			for (int i = 0; i < 3; i++) {
+				Search::Result r = search.run(board, c.algorithm, c.heuristic, 2, budgets[i]);
+				string name = path + " " + c.name + ": ";
+				if (r.exceeded != expected[i]) {
+					ok = fail(name + Budget::name(r.exceeded) + " exceeded instead of " + Budget::name(expected[i]));
+				}
+				else if (r.solved()) {
+					ok = fail(name + "solved despite the " + Budget::name(expected[i]) + " budget");
+				}
+			}
+		}
+		return ok;
+	}
+
+	// the BFS solution of a level, from its normalized start
+	bool solution(const string& path, Path& p) {
+		State board;
+		if (Corpus::readLevel(path, board) != Corpus::OK) return fail(path + ": cannot read the level");
+		board.normalize();
+		p = Search().run(board, Search::BFS).path;
+		return p.size() > 0 || fail(path + ": not solved");
+	}
+
+	// the state after the first "n" moves of a path
+	State after(const Path& p, const size_t n) {
+		State s(p.root);
+		for (size_t i = 0; i < n; i++) {
+			s.applyMove(p.moves[i]);
+			s.normalize();
+		}
+		return s;
+	}
+
+	// true if the cache answers a state with an optimal solution of "length" moves that replays
+	bool answers(SolutionCache& cache, const State& s, const size_t length) {
+		Path p;
+		return cache.find(s, p) && p.size() == length && replays(s, p.moves);
+	}
+
+	size_t fileSize(const string& path) {
+		ifstream in(path, ios::binary | ios::ate);
+		return in ? (size_t) in.tellg() : 0;
+	}
+
+	/* a state halfway along a solution, the least recently used solution
+	 * going first and a state along two solutions staying with the other one */
+	bool testCache(const string& directory) {
+		Path level0, level1, level2, level5;
+		if (!solution(directory + "/level0.txt", level0) || !solution(directory + "/level1.txt", level1)
+			|| !solution(directory + "/level2.txt", level2) || !solution(directory + "/level5.txt", level5)) {
+			return false;
+		}
+		bool ok = true;
+		SolutionCache cache;
+		cache.store(level5);
+		if (!answers(cache, after(level5, 20), level5.size() - 20)) ok = fail("cache: no solution halfway");
+		// 6 + 13 + 17 states, room for 30: level2 was used least recently
+		SolutionCache small(30);
+		small.store(level0);
+		small.store(level2);
+		answers(small, level0.root, level0.size());
+		small.store(level1);
+		if (answers(small, level2.root, level2.size()) || !answers(small, level0.root, level0.size())
+			|| !answers(small, level1.root, level1.size())) {
+			ok = fail("cache: not the least recently used solution evicted");
+		}
+		/* a second solution that joins level5 at move 10 from a side step:
+		 * level5 goes first (10 states of its own), the rest stays with it */
+		SolutionCache shared(45);
+		shared.store(level5);
+		State joint = after(level5, 10);
+		vector<Move> moves;
+		joint.getAllMoves(moves);
+		Path side;
+		for (const Move& m : moves) {
+			State s(joint);
+			s.applyMove(m);
+			s.normalize();
+			Path found;
+			if (shared.find(s, found)) continue;
+			// back onto the solution, then along it
+			int row = m.piece.row + (m.dir == Moves::DOWN) - (m.dir == Moves::UP);
+			int col = m.piece.col + (m.dir == Moves::RIGHT) - (m.dir == Moves::LEFT);
+			side = Path(s);
+			side.moves.push_back(Move{ s.getPiece(s.at(row, col)), inverse(m.dir) });
+			side.moves.insert(side.moves.end(), level5.moves.begin() + 10, level5.moves.end());
+			break;
+		}
+		if (side.size() == 0) return fail("cache: no side step off level5");
+		shared.store(side);
+		shared.store(level0);
+		if (answers(shared, level5.root, level5.size()) || !answers(shared, after(level5, 20), level5.size() - 20)
+			|| !answers(shared, side.root, side.size())) {
+			ok = fail("cache: the states of an evicted solution along another one are lost");
+		}
+		return ok;
+	}
+
+	/* the file of a cache: read back, a partly written record and a record
+	 * whose move does not fit the board at the end cut off */
+	bool testCacheFile(const string& directory, const string& temporary) {
+		Path level0, level2;
+		if (!solution(directory + "/level0.txt", level0) || !solution(directory + "/level2.txt", level2)) {
+			return false;
+		}
+		const string path = temporary + "/SolveTest.sol";
+		remove(path.c_str());
+		{
+			SolutionCache cache;
+			if (!cache.open(path)) return fail("cache: cannot create '" + path + "'");
+			cache.store(level0);
+			cache.store(level2);
+		}
+		const size_t size = fileSize(path);
+		bool ok = true;
+		// a record of one move of a piece far below the board
+		vector<unsigned char> corrupt(2 + State::PACKED_SIZE + 6, 0);
+		corrupt[0] = 1;
+		level0.root.pack(corrupt.data() + 2);
+		const unsigned char move[6] = { 2, 200, 0, 1, 1, (unsigned char) Moves::UP };
+		copy(move, move + 6, corrupt.end() - 6);
+		const vector<unsigned char> tails[] = { {}, { 5, 0, 1 }, corrupt };
+		const string names[] = { "reopened", "partly written record", "corrupt record" };
+		for (int i = 0; i < 3; i++) {
+			{
+				ofstream out(path, ios::binary | ios::app);
+				out.write(reinterpret_cast<const char*>(tails[i].data()), (streamsize) tails[i].size());
+			}
+			SolutionCache cache;
+			if (!cache.open(path)) {
+				ok = fail("cache " + names[i] + ": cannot open");
+			}
+			else if (!answers(cache, level0.root, level0.size()) || !answers(cache, after(level2, 3), level2.size() - 3)) {
+				ok = fail("cache " + names[i] + ": solutions lost");
+			}
+			else if (fileSize(path) != size) {
+				ok = fail("cache " + names[i] + ": not cut off");
+			}
+		}
+		remove(path.c_str());
+		return ok;
+	}
+
+	/* solve() on all levels at once, one thread per level and configuration.
+	 * the *-pattern configurations share a Store of fewer layouts than levels */
+	bool testConcurrent(const string& directory) {
+		const vector<Config> all = configs();
+		vector<State> boards(LEVELS);
+		for (int i = 0; i < LEVELS; i++) {
+			string path = directory + "/level" + to_string(i) + ".txt";
+			if (Corpus::readLevel(path, boards[i]) != Corpus::OK) return fail(path + ": cannot read the level");
+		}
+		vector<SolveResult> results(LEVELS * all.size());
+		PatternDatabase::Store patterns(4);
+		vector<thread> threads;
+		for (int i = 0; i < LEVELS; i++) {
+			for (size_t c = 0; c < all.size(); c++) {
+				if (all[c].deepening && i >= DEEPENING_LEVELS) continue;
+				SolveOptions options(all[c].algorithm, all[c].heuristic);
+				options.patterns = &patterns;
+				SolveResult* r = &results[i * all.size() + c];
+				const State* board = &boards[i];
+				threads.push_back(thread([r, board, options]() { *r = solve(*board, options); }));
+			}
+		}
+		for (thread& t : threads) t.join();
+		bool ok = true;
+		for (int i = 0; i < LEVELS; i++) {
+			for (size_t c = 0; c < all.size(); c++) {
+				if (all[c].deepening && i >= DEEPENING_LEVELS) continue;
+				const SolveResult& r = results[i * all.size() + c];
+				string name = "level" + to_string(i) + " " + all[c].name + " (solve): ";
+				if (r.status != SolveResult::SOLVED || !replays(boards[i], r.moves)) {
+					ok = fail(name + "not solved");
+				}
+				else if (all[c].optimal && r.cost != LENGTHS[i]) {
+					ok = fail(name + to_string(r.cost) + " moves instead of " + to_string(LENGTHS[i]));
+				}
+			}
+		}
+		if (patterns.size() > 4) ok = fail("solve: the pattern database store outgrew its capacity");
+		return ok;
+	}
+
+	/* boards solve() must turn down: empty, too large, padding that is not
+	 * wall, a cell below -1, no master, a piece that is not a rectangle */
+	bool testInvalid() {
+		const State valid = board({
+			{ 1, -1, -1, -1, 1, 1 },
+			{ 1, 3, 2, 4, 0, 1 },
+			{ 1, 0, 5, 5, 0, 1 },
+			{ 1, 0, 0, 0, 0, 1 },
+			{ 1, 1, 1, 1, 1, 1 },
+		});
+		vector<pair<string, State>> boards(6, make_pair(string(), valid));
+		boards[0] = make_pair("empty", State());
+		boards[1].first = "too large";
+		boards[1].second.width = boards[1].second.height = 8;
+		boards[2].first = "padding";
+		boards[2].second.at(0, State::MAX_CELLS - 1) = 0;
+		boards[3].first = "cell below -1";
+		boards[3].second.at(3, 1) = -2;
+		boards[4].first = "no master";
+		boards[4].second.at(1, 2) = 0;
+		boards[5].first = "L-shaped piece";
+		boards[5].second.at(3, 1) = boards[5].second.at(3, 2) = boards[5].second.at(2, 1) = 6;
+		bool ok = solve(valid).status == SolveResult::SOLVED || fail("solve: valid board not solved");
+		for (const pair<string, State>& b : boards) {
+			if (solve(b.second).status != SolveResult::INVALID_BOARD) ok = fail("solve: " + b.first + " not invalid");
+		}
+		Matrix large(valid.toMatrix());
+		large.at(3, 1) = 200;
+		if (solve(large).status != SolveResult::INVALID_BOARD) ok = fail("solve: Matrix value 200 not invalid");
+		return ok;
+	}
+}
+
+
+int main(int argc, char* argv[]) {
+	string directory = argc > 1 ? argv[1] : "level";
+	string temporary = argc > 2 ? argv[2] : ".";
+	bool ok = true;
+	for (int i = 0; i < LEVELS; i++) {
+		ok = testLevel(directory + "/level" + to_string(i) + ".txt", i) && ok;
+	}
+	ok = testWideExit() && ok;
+	ok = testExitsOneByOne() && ok;
+	ok = testAnytime(directory + "/level9.txt", 9) && ok;
+	ok = testBudget(directory + "/level9.txt") && ok;
+	ok = testCache(directory) && ok;
+	ok = testCacheFile(directory, temporary) && ok;
+	ok = testConcurrent(directory) && ok;
+	ok = testInvalid() && ok;
+	cout << (ok ? "all solutions correct" : "FAILED") << endl;
+	return ok ? 0 : 1;
+}
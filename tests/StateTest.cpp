@@ -0,0 +1,212 @@
+#include "State.h"
+#include "Corpus.h"
+#include "Board.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+
+using namespace std;
+
+/* consistency of the State operations the searches rely on, over the
+ * first states of a breadth first walk of every level
+ *   StateTest <level directory>
+ * per state and move: moveHash = hash of the child, the hash does not change
+ * by normalizing, equivalent() holds between a child and its normalized copy
+ * (and not between different states), undoMove restores the board,
+ * pack/unpack round trips, the vectorized board scans (Kernels.h) of
+ * every instruction set of the CPU agree with the scalar ones and the board
+ * operations compiled for a fixed size (Board.h) with the State ones.
+ * The same walk runs on a board with a wide exit, which the master brick
+ * consumes cell by cell and other pieces then enter: every piece must stay
+ * one rectangle of its own through normalize.
+ * returns 1 on the first failure */
+
+namespace {
+	// states walked per level
+	const size_t STATES = 2000;
+	const int LEVELS = 11;
+
+	bool check(const bool ok, const string& level, const string& what) {
+		if (!ok) cout << level << ": " << what << endl;
+		return ok;
+	}
+
+	// the kernels of every supported level give the masks of the scalar kernels
+	bool kernelsAgree(const State& a, const State& b) {
+		unsigned char image[2][State::PACKED_SIZE];
+		a.pack(image[0]);
+		b.pack(image[1]);
+		const signed char* x = reinterpret_cast<const signed char*>(image[0] + 2);
+		const signed char* y = reinterpret_cast<const signed char*>(image[1] + 2);
+		const Kernels::Set& scalar = Kernels::get(Kernels::SCALAR);
+		for (int l = Kernels::SCALAR + 1; l < Kernels::LEVELS; l++) {
+			if (!Kernels::supported((Kernels::Level) l)) continue;
+			const Kernels::Set& k = Kernels::get((Kernels::Level) l);
+			// every board size up to the whole array, for the partial blocks
+			for (int n = 1; n <= State::MAX_CELLS; n++) {
+				for (signed char v = -1; v <= 3; v++) {
+					if (k.equalTo(x, n, v) != scalar.equalTo(x, n, v)) return false;
+					if (k.greaterThan(x, n, v) != scalar.greaterThan(x, n, v)) return false;
+				}
+				if (k.compare(x, y, n) != scalar.compare(x, y, n)) return false;
+			}
+		}
+		return true;
+	}
+
+	// FixedBoard gives the moves, hashes and boards of the State operations
+	template <typename Board>
+	bool boardAgrees(const State& state) {
+		vector<Move> expected, moves;
+		state.getAllMoves(expected);
+		Board::getAllMoves(state, moves);
+		if (moves.size() != expected.size() || Board::hash(state) != state.hash()) return false;
+		for (size_t i = 0; i < moves.size(); i++) {
+			const Move& a = moves[i];
+			const Move& b = expected[i];
+			if (a.dir != b.dir || a.piece.label != b.piece.label || a.piece.row != b.piece.row
+				|| a.piece.col != b.piece.col || a.piece.width != b.piece.width
+				|| a.piece.height != b.piece.height) return false;
+			if (Board::moveHash(state, state.hash(), a) != state.moveHash(state.hash(), a)) return false;
+			State child(state), fixed(state);
+			unsigned long long exits = child.applyMove(a);
+			if (Board::applyMove(fixed, a) != exits || fixed != child) return false;
+			State normalized(child);
+			normalized.normalize();
+			Board::normalize(fixed);
+			if (fixed != normalized) return false;
+			Board::undoMove(child, a, exits);
+			if (child != state) return false;
+		}
+		return true;
+	}
+
+	bool boardAgrees(const State& state) {
+		if (FixedBoard<5, 4>::fits(state)) return boardAgrees<FixedBoard<5, 4>>(state);
+		if (FixedBoard<6, 6>::fits(state)) return boardAgrees<FixedBoard<6, 6>>(state);
+		if (FixedBoard<6, 7>::fits(state)) return boardAgrees<FixedBoard<6, 7>>(state);
+		return true;
+	}
+
+	// true if the pieces (getPieces) cover exactly the cells with a label > 1
+	bool piecesIntact(const State& state) {
+		Piece pieces[State::MAX_CELLS];
+		int n = state.getPieces(pieces);
+		int area = 0;
+		for (int k = 0; k < n; k++) {
+			const Piece& p = pieces[k];
+			for (int r = p.row; r < p.row + p.height; r++) {
+				for (int c = p.col; c < p.col + p.width; c++) {
+					if (state.at(r, c) != p.label) return false;
+				}
+			}
+			area += p.width * p.height;
+		}
+		return area == Kernels::count(state.maskAbove(1));
+	}
+
+	// a board of rows of cells
+	State board(const vector<vector<int>>& rows) {
+		State s;
+		s.height = (unsigned char) rows.size();
+		s.width = (unsigned char) rows[0].size();
+		for (int i = 0; i < s.height; i++) {
+			for (int j = 0; j < s.width; j++) s.at(i, j) = (signed char) rows[i][j];
+		}
+		return s;
+	}
+
+	/* an exit of three cells, a 1x1 master. after the master covered and left
+	 * the first exit cell, piece 3 moves onto it (into the top edge) */
+	const vector<vector<int>> WIDE_EXIT = {
+		{ 1, -1, -1, -1, 1, 1 },
+		{ 1, 2, 0, 0, 0, 1 },
+		{ 1, 3, 0, 4, 4, 1 },
+		{ 1, 0, 0, 0, 0, 1 },
+		{ 1, 1, 1, 1, 1, 1 },
+	};
+
+	bool testWideExit() {
+		const string name = "wide exit";
+		State s = board(WIDE_EXIT);
+		const pair<int, Moves> steps[] = { { 2, Moves::UP }, { 2, Moves::DOWN }, { 2, Moves::RIGHT },
+			{ 3, Moves::UP }, { 3, Moves::UP } };
+		for (const pair<int, Moves>& step : steps) {
+			s.applyMove(step.first, step.second);
+			s.normalize();
+		}
+		if (!check(s.at(0, 1) == 3 && s.at(2, 3) == 4, name, "normalize renames pieces on the edge wrongly")) return false;
+		if (!check(piecesIntact(s), name, "a piece on a former exit merges with another one")) return false;
+		if (!check(!s.isSolved(), name, "solved with two exit cells left")) return false;
+		return true;
+	}
+
+	bool testWalk(const string& path, State start) {
+		start.normalize();
+		deque<State> queue{ start };
+		// hash -> indices into "queue" (all states seen so far)
+		unordered_map<size_t, vector<size_t>> seen{ { start.hash(), { 0 } } };
+		vector<Move> moves;
+		for (size_t i = 0; i < queue.size() && i < STATES; i++) {
+			const State state = queue[i];
+			size_t hash = state.hash();
+			unsigned char image[State::PACKED_SIZE];
+			state.pack(image);
+			State unpacked;
+			if (!check(unpacked.unpack(image) && unpacked == state, path, "pack/unpack round trip")) return false;
+			if (!check(kernelsAgree(state, queue[i / 2]), path, "vectorized kernels differ from the scalar ones")) return false;
+			if (!check(boardAgrees(state), path, "fixed size board operations differ from the State ones")) return false;
+			if (!check(piecesIntact(state), path, "the pieces do not cover the board")) return false;
+			if (state.isSolved()) continue;
+			state.getAllMoves(moves);
+			for (const Move& move : moves) {
+				State child = state.applyMoveCloning(move);
+				if (!check(state.moveHash(hash, move) == child.hash(), path, "moveHash differs from hash")) return false;
+				State undone(state);
+				unsigned long long exits = undone.applyMove(move);
+				if (!check(undone == child, path, "applyMove differs from applyMoveCloning")) return false;
+				undone.undoMove(move, exits);
+				if (!check(undone == state, path, "undoMove does not restore the board")) return false;
+				State normalized(child);
+				normalized.normalize();
+				if (!check(normalized.hash() == child.hash(), path, "normalize changes the hash")) return false;
+				if (!check(child.equivalent(normalized) && normalized.equivalent(child), path,
+					"a state is not equivalent to its normalized copy")) return false;
+				if (!check(!child.equivalent(state), path, "a move leads to an equivalent state")) return false;
+				bool known = false;
+				for (size_t j : seen[child.hash()]) {
+					if (queue[j].equivalent(normalized)) {
+						known = true;
+						// equivalent states are equal once normalized
+						if (!check(queue[j] == normalized, path, "equivalent states differ after normalizing")) return false;
+						break;
+					}
+				}
+				if (!known) {
+					seen[child.hash()].push_back(queue.size());
+					queue.push_back(normalized);
+				}
+			}
+		}
+		return true;
+	}
+
+	bool testLevel(const string& path) {
+		State start;
+		if (!check(Corpus::readLevel(path, start) == Corpus::OK, path, "cannot read the level")) return false;
+		return testWalk(path, start);
+	}
+}
+
+
+int main(int argc, char* argv[]) {
+	string directory = argc > 1 ? argv[1] : "level";
+	for (int i = 0; i < LEVELS; i++) {
+		if (!testLevel(directory + "/level" + to_string(i) + ".txt")) return 1;
+	}
+	if (!testWideExit() || !testWalk("wide exit", board(WIDE_EXIT))) return 1;
+	cout << "State operations consistent on " << LEVELS << " levels and a wide exit" << endl;
+	return 0;
+}